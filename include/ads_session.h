@@ -0,0 +1,153 @@
+/*
+ *  ADS1115 session manager
+ *
+ *  Configures the ADC once (gain, data rate, mux) and keeps track of its state
+ *  so the main loop does not have to re-run begin()/setGain() every cycle.
+ *  Health is judged cheaply from the conversion results; the I2C bus is only
+ *  probed, and the ADC only re-initialised, when a result looks like a bus error.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_ADS1X15.h>
+
+#define ADS_I2C_ADDR      0x48
+#define ADS_GAIN          GAIN_TWO            // 2x gain +/- 2.048V  1 bit = 0.0625mV
+#define ADS_MV_PER_BIT    0.0625              // Update to match ADS_GAIN
+#define ADS_MUX           ADS1X15_REG_CONFIG_MUX_DIFF_0_1
+#define ADS_SUSPECT_LIMIT 3                   // suspect conversions in a row before probing the bus
+#define ADS_RETRY_MS      500                 // back-off between reconnect attempts
+
+#ifndef ADS_DATA_RATE
+#define ADS_DATA_RATE     RATE_ADS1115_128SPS // library default
+#endif
+
+enum AdsState
+{
+    ADS_DOWN,     // not configured, or the last reconnect failed
+    ADS_READY,    // configured and returning plausible conversions
+    ADS_SUSPECT   // recent conversions look like bus errors
+};
+
+struct AdsSession
+{
+    Adafruit_ADS1115 *adc = nullptr;
+    AdsState state = ADS_DOWN;
+    adsGain_t gain = ADS_GAIN;
+    uint16_t dataRate = ADS_DATA_RATE;
+    uint16_t mux = ADS_MUX;
+    float multiplier = ADS_MV_PER_BIT;
+    bool continuous = false;   // free-running conversions, restarted on reconnect
+    int16_t lastGood = 0;      // last conversion that passed the health check
+    uint8_t suspect = 0;       // consecutive suspect conversions
+    uint32_t lastRetry = 0;    // millis() of the last reconnect attempt
+    uint32_t busErrors = 0;    // probes that NACKed
+    uint32_t reconnects = 0;   // successful re-initialisations
+};
+
+// Push the session's gain and data rate to the chip
+bool adsConfigure(AdsSession &s)
+{
+    if (!s.adc->begin(ADS_I2C_ADDR))
+    {
+        s.state = ADS_DOWN;
+        return false;
+    }
+    s.adc->setGain(s.gain);
+    s.adc->setDataRate(s.dataRate);
+    if (s.continuous)
+    {
+        s.adc->startADCReading(s.mux, true);
+    }
+    s.suspect = 0;
+    s.state = ADS_READY;
+    return true;
+}
+
+// Conversions per second for an ADS1115 data rate setting
+uint16_t adsRateSps(uint16_t rate)
+{
+    static const uint16_t sps[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+    return sps[(rate >> 5) & 0x07];
+}
+
+// Configure the ADC once, from setup()
+bool adsOpen(AdsSession &s, Adafruit_ADS1115 &adc)
+{
+    s.adc = &adc;
+    return adsConfigure(s);
+}
+
+// Address-only write; an ACK means the ADC is still on the bus
+bool adsProbe()
+{
+    Wire.beginTransmission(ADS_I2C_ADDR);
+    return (Wire.endTransmission() == 0);
+}
+
+// A failed I2C read leaves the conversion register as 0x0000 or 0xFFFF, and a
+// glitched config can rail the PGA.  A genuine reading can also land on these
+// values (sensor unplugged), so they only raise suspicion until the bus is probed.
+bool adsSuspect(int16_t raw)
+{
+    return (raw == 0 || raw == -1 || raw == INT16_MAX || raw == INT16_MIN);
+}
+
+// Re-run the configuration, rate limited so a dead bus cannot stall the loop
+bool adsReconnect(AdsSession &s)
+{
+    uint32_t now = millis();
+    if (s.state == ADS_DOWN && (now - s.lastRetry) < ADS_RETRY_MS)
+    {
+        return false;
+    }
+    s.lastRetry = now;
+    if (adsConfigure(s))
+    {
+        s.reconnects++;
+        return true;
+    }
+    return false;
+}
+
+// Feed each conversion through here.  Returns the value to use: the raw reading
+// when healthy, otherwise the last good one while the bus is being recovered.
+// That only bridges a few suspect conversions: once the session is ADS_DOWN the
+// UI must show the ADC fault instead of a reading.
+int16_t adsCheck(AdsSession &s, int16_t raw)
+{
+    if (s.state == ADS_DOWN)
+    {
+        adsReconnect(s);
+        return s.lastGood;
+    }
+
+    if (!adsSuspect(raw))
+    {
+        s.suspect = 0;
+        s.state = ADS_READY;
+        s.lastGood = raw;
+        return raw;
+    }
+
+    if (++s.suspect < ADS_SUSPECT_LIMIT)
+    {
+        s.state = ADS_SUSPECT;
+        return s.lastGood;
+    }
+
+    // Several suspect results in a row: find out whether the bus is really at fault
+    s.suspect = 0;
+    if (adsProbe())
+    {
+        s.state = ADS_READY;
+        s.lastGood = raw;
+        return raw;
+    }
+    s.busErrors++;
+    s.state = ADS_DOWN;
+    adsReconnect(s);
+    return s.lastGood;
+}
@@ -0,0 +1,96 @@
+/*
+ *  Benchmark statistics
+ *
+ *  Each timed path keeps a count, the mean and the maximum over the whole run and
+ *  its last BENCH_SAMPLES timings, which the median and the 99th percentile are
+ *  taken from.  benchReport() writes all of them as one JSON line, so runs of two
+ *  firmware versions (or of the native build) can be compared by a script:
+ *
+ *    {"bench":"EANx","version":"...","board":"...","stats":{
+ *      "filter":{"unit":"us","n":1234,"mean":5,"p50":5,"p99":9,"max":31},...}}
+ *
+ *  Integer values only, the SAMD boards print without printf %f.  A stat has a
+ *  single writer; the report may read it while it is updated, which can skew one
+ *  report by a sample but never blocks the timed path.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#ifndef BENCH_SAMPLES
+#define BENCH_SAMPLES 128 // recent timings the percentiles are taken over
+#endif
+
+struct BenchStat
+{
+    const char *name;
+    const char *unit;
+    uint32_t recent[BENCH_SAMPLES];
+    uint16_t idx = 0;
+    uint32_t n = 0;
+    uint64_t sum = 0;
+    uint32_t max = 0;
+
+    BenchStat(const char *name, const char *unit) : name(name), unit(unit) {}
+};
+
+struct BenchSummary
+{
+    uint32_t n, mean, p50, p99, max;
+};
+
+inline void benchAdd(BenchStat &s, uint32_t v)
+{
+    s.recent[s.idx] = v;
+    s.idx = (s.idx + 1) % BENCH_SAMPLES;
+    s.n++;
+    s.sum += v;
+    s.max = (v > s.max) ? v : s.max;
+}
+
+inline void benchReset(BenchStat &s)
+{
+    s.idx = 0;
+    s.n = 0;
+    s.sum = 0;
+    s.max = 0;
+}
+
+inline BenchSummary benchSummary(const BenchStat &s)
+{
+    BenchSummary r = {s.n, 0, 0, 0, s.max};
+    uint16_t k = (s.n < BENCH_SAMPLES) ? s.n : BENCH_SAMPLES;
+    if (k == 0)
+    {
+        return r;
+    }
+    uint32_t v[BENCH_SAMPLES];
+    memcpy(v, s.recent, k * sizeof(uint32_t));
+    std::sort(v, v + k);
+    r.mean = (uint32_t)((s.sum + s.n / 2) / s.n);
+    r.p50 = v[(k - 1) / 2];
+    r.p99 = v[(k * 99 + 99) / 100 - 1]; // nearest rank
+    return r;
+}
+
+// Write the report through out(), a piece at a time
+inline void benchReport(BenchStat *const *stats, uint8_t count, const char *version, const char *board,
+                        void (*out)(const char *s))
+{
+    char buf[112];
+    snprintf(buf, sizeof(buf), "{\"bench\":\"EANx\",\"version\":\"%s\",\"board\":\"%s\",\"stats\":{", version, board);
+    out(buf);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        BenchSummary r = benchSummary(*stats[i]);
+        snprintf(buf, sizeof(buf), "%s\"%s\":{\"unit\":\"%s\",\"n\":%lu,\"mean\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}",
+                 i ? "," : "", stats[i]->name, stats[i]->unit, (unsigned long)r.n, (unsigned long)r.mean,
+                 (unsigned long)r.p50, (unsigned long)r.p99, (unsigned long)r.max);
+        out(buf);
+    }
+    out("}}\n");
+}
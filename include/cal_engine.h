@@ -0,0 +1,119 @@
+/*
+ *  Statistical early-exit calibration
+ *
+ *  Replaces the fixed "61 samples, wait, 61 more, compare" routine.  Every sample
+ *  updates a running mean, variance and slope (trend_stats.h); calibration ends as
+ *  soon as the 95% confidence interval of the mean and the drift (fitted slope) are
+ *  both inside their limits.  A window that has not settled is restarted so early
+ *  settling does not drag the mean, and a hard timeout ends in CAL_FAILED instead
+ *  of retrying forever.
+ *
+ *  The confidence interval takes every conversion as an independent sample.
+ *  That holds for the ADC's own white noise, not for slow wander of the cell:
+ *  anything correlated over more than a conversion makes the real interval
+ *  wider than the one computed, so CAL_CI_PCT is a bound on the ADC noise only.
+ *  Cell wander is left to the drift limit and the window restart.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "trend_stats.h"
+
+#define CAL_MIN_MS       750    // shortest window that may be accepted
+#define CAL_WINDOW_MS    3000   // restart a window that is still drifting by then
+#define CAL_TIMEOUT_MS   12000  // give up
+#define CAL_CI_PCT       0.2    // 95% CI half-width of the mean, % of the mean
+#define CAL_DRIFT_PCT_S  0.2    // drift limit, % of the mean per second (0.5% over the old 2.5 s check)
+#define CAL_MIN_COUNTS   16     // 1 mV at GAIN_TWO, below this there is no sensor
+
+enum CalState
+{
+    CAL_RUNNING,
+    CAL_DONE,
+    CAL_FAILED
+};
+
+struct CalEngine
+{
+    CalState state = CAL_RUNNING;
+    uint32_t startMs = 0;    // calibration start
+    uint32_t windowMs = 0;   // current window start
+    TrendStats stats;        // current window
+    int32_t sum = 0;         // raw counts in the current window, for the integer path
+    uint16_t count = 0;
+    uint8_t restarts = 0;    // windows dropped for not settling
+    float ciPct = 0;         // last confidence interval, % of mean
+    float driftPct = 0;      // last drift estimate, % of mean per second
+};
+
+inline void calBegin(CalEngine &c, uint32_t nowMs)
+{
+    c = CalEngine();
+    c.startMs = nowMs;
+    c.windowMs = nowMs;
+}
+
+inline void calRestartWindow(CalEngine &c, uint32_t nowMs)
+{
+    trendReset(c.stats);
+    c.sum = 0;
+    c.count = 0;
+    c.windowMs = nowMs;
+    c.restarts++;
+}
+
+// Feed one conversion (absolute counts).  Returns the engine state.
+inline CalState calAdd(CalEngine &c, uint32_t nowMs, int16_t counts)
+{
+    if (c.state != CAL_RUNNING)
+    {
+        return c.state;
+    }
+
+    if ((nowMs - c.startMs) > CAL_TIMEOUT_MS)
+    {
+        c.state = CAL_FAILED;
+        return c.state;
+    }
+
+    uint32_t age = nowMs - c.windowMs;
+    trendAdd(c.stats, age / 1000.0f, counts);
+    c.sum += counts;
+    c.count++;
+
+    if (age < CAL_MIN_MS)
+    {
+        return c.state;
+    }
+
+    float mean = c.stats.meanY;
+    if (mean < CAL_MIN_COUNTS)
+    {
+        c.ciPct = c.driftPct = INFINITY;
+    }
+    else
+    {
+        c.ciPct = 1.96f * trendStdErr(c.stats) / mean * 100;
+        c.driftPct = fabsf(trendSlope(c.stats)) / mean * 100;
+        if (c.ciPct < CAL_CI_PCT && c.driftPct < CAL_DRIFT_PCT_S)
+        {
+            c.state = CAL_DONE;
+            return c.state;
+        }
+    }
+
+    // A drifting window is dropped; a merely noisy one keeps accumulating
+    if ((age > CAL_WINDOW_MS && c.driftPct >= CAL_DRIFT_PCT_S) || c.count == UINT16_MAX)
+    {
+        calRestartWindow(c, nowMs);
+    }
+    return c.state;
+}
+
+// Mean counts of the accepted window
+inline float calMean(const CalEngine &c)
+{
+    return c.stats.meanY;
+}
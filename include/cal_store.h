@@ -0,0 +1,98 @@
+/*
+ *  Persistent calibration record
+ *
+ *  The last full calibration is kept in flash (EEPROM emulation, backed by NVS on
+ *  the ESP32) together with the sensor mV in air and the chip ID it was taken on.
+ *  On boot a short verification read against the stored record lets the unit skip
+ *  the full calibration while the sensor is still within tolerance.
+ *
+ *  The record is written by a full calibration only.  The number of warm starts
+ *  since is counted in an NVS key of its own (ESP32), so a warm boot rewrites four
+ *  bytes there and never the record.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "crc16.h"
+#if defined(ESP32)
+#include <Preferences.h>
+#endif
+
+#define CAL_STORE_ADDR     0       // the record is all the EEPROM holds
+#define CAL_STORE_MAGIC    0x45414E32UL // "EAN2", no warm start count in the record
+#define CAL_VERIFY_MS      400     // length of the warm start verification read
+#define CAL_VERIFY_PCT     0.5     // stored and measured air counts must agree within this
+#define CAL_MAX_WARM       50      // force a full calibration after this many warm starts
+#define CAL_WARM_NS        "cal"   // NVS namespace and key of the warm start count
+#define CAL_WARM_KEY       "warm"
+
+struct CalRecord
+{
+    uint32_t magic;
+    float calFactor;     // % O2 per count
+    int32_t calFactorQ;  // same in Q8.24, for FIXED_MATH
+    float airCounts;     // mean counts in air at calibration
+    float airMv;         // sensor mV in air at calibration
+    uint64_t chipId;     // board the record belongs to
+    uint16_t crc;        // over everything above
+};
+
+uint16_t calRecordCrc(const CalRecord &r)
+{
+    return crc16(&r, offsetof(CalRecord, crc));
+}
+
+// Once from setup(), before calLoad() or calSave().  On the ESP32 every begin()
+// allocates a fresh RAM mirror and reads it back from NVS.
+void calStoreBegin()
+{
+    EEPROM.begin(CAL_STORE_ADDR + sizeof(CalRecord));
+}
+
+// Load the record for this chip.  Returns false if there is none or it is damaged.
+bool calLoad(CalRecord &r, uint64_t chip)
+{
+    EEPROM.get(CAL_STORE_ADDR, r);
+    return (r.magic == CAL_STORE_MAGIC && r.crc == calRecordCrc(r) && r.chipId == chip);
+}
+
+void calSave(CalRecord &r)
+{
+    r.magic = CAL_STORE_MAGIC;
+    r.crc = calRecordCrc(r);
+    EEPROM.put(CAL_STORE_ADDR, r);
+    EEPROM.commit();
+}
+
+#if defined(ESP32)
+// Warm starts since the record was written.  Missing reads as CAL_MAX_WARM, so
+// a record without a count of its own gets a full calibration.
+uint32_t calWarmBoots()
+{
+    Preferences prefs;
+    prefs.begin(CAL_WARM_NS, true);
+    uint32_t n = prefs.getUInt(CAL_WARM_KEY, CAL_MAX_WARM);
+    prefs.end();
+    return n;
+}
+
+void calSetWarmBoots(uint32_t n)
+{
+    Preferences prefs;
+    prefs.begin(CAL_WARM_NS, false);
+    prefs.putUInt(CAL_WARM_KEY, n);
+    prefs.end();
+}
+#endif
+
+// Does a fresh reading in air still match the stored calibration?
+bool calVerify(const CalRecord &r, uint32_t warmBoots, float airCounts)
+{
+    if (warmBoots >= CAL_MAX_WARM || r.airCounts <= 0)
+    {
+        return false;
+    }
+    return (fabsf(airCounts / r.airCounts - 1) * 100 <= CAL_VERIFY_PCT);
+}
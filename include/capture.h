@@ -0,0 +1,330 @@
+/*
+ *  Raw ADC capture stream
+ *
+ *  Records every conversion the analyser reads, counts and micros(), so a field
+ *  unit's sample stream can be replayed on the host through the same
+ *  calibration, filter and display code.  The stream is a series of chunks:
+ *
+ *    0xA5 0x5A  type  len  payload[len]  crc16 (LE, over type, len and payload)
+ *
+ *    'H' header   version, sps (uint16), mV per count (float), LE
+ *    'S' samples  first us (uint32), first counts (int16), then per conversion the
+ *                 change of the us step and of the counts, zigzag varints
+ *
+ *  At a steady data rate a conversion takes about two bytes.  Every chunk stands
+ *  on its own and is CRC checked, so the reader resyncs past text interleaved on
+ *  the same serial port or a corrupted chunk, and a capture joined late decodes
+ *  from the next chunk on.  The header is repeated every CAP_HEADER_EVERY chunks.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "crc16.h"
+#include "hal/hal.h"
+
+#define CAP_VERSION      1
+#define CAP_SYNC0        0xA5
+#define CAP_SYNC1        0x5A
+#define CAP_HEADER       'H'
+#define CAP_SAMPLES      'S'
+#define CAP_PAYLOAD_MAX  120  // payload bytes per chunk
+#define CAP_CHUNK_MAX    (CAP_PAYLOAD_MAX + 6)
+#define CAP_HEADER_EVERY 16   // sample chunks between headers
+
+// One finished chunk, ready to be written out as is
+struct CaptureChunk
+{
+    uint8_t len;
+    uint8_t data[CAP_CHUNK_MAX];
+};
+
+struct CaptureWriter
+{
+    void (*emit)(const CaptureChunk &c) = nullptr; // called with every finished chunk
+    uint16_t sps = 0;
+    float mvPerCount = 0;
+    uint8_t payload[CAP_PAYLOAD_MAX];
+    uint8_t len = 0;          // payload bytes in the open chunk, 0 = none open
+    uint32_t lastUs = 0;
+    int32_t lastStep = 0;     // us between the last two conversions
+    int16_t lastCounts = 0;
+    uint16_t sinceHeader = 0;
+    uint32_t samples = 0;     // conversions recorded
+    uint32_t chunks = 0;      // chunks emitted, headers included
+};
+
+inline uint32_t capZigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+inline int32_t capUnzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+inline uint8_t capPutVarint(uint8_t *p, uint32_t v)
+{
+    uint8_t n = 0;
+    while (v >= 0x80)
+    {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+inline void capPut32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+inline uint32_t capGet32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Frame a payload and hand it to emit
+inline void capEmit(CaptureWriter &w, uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    CaptureChunk c;
+    c.data[0] = CAP_SYNC0;
+    c.data[1] = CAP_SYNC1;
+    c.data[2] = type;
+    c.data[3] = len;
+    memcpy(c.data + 4, payload, len);
+    uint16_t crc = crc16(c.data + 2, len + 2);
+    c.data[4 + len] = crc;
+    c.data[5 + len] = crc >> 8;
+    c.len = len + 6;
+    w.chunks++;
+    if (w.emit)
+    {
+        w.emit(c);
+    }
+}
+
+inline void capHeader(CaptureWriter &w)
+{
+    uint8_t p[7];
+    uint32_t mv;
+    memcpy(&mv, &w.mvPerCount, 4);
+    p[0] = CAP_VERSION;
+    p[1] = w.sps;
+    p[2] = w.sps >> 8;
+    capPut32(p + 3, mv);
+    capEmit(w, CAP_HEADER, p, sizeof(p));
+    w.sinceHeader = 0;
+}
+
+inline void capBegin(CaptureWriter &w, uint16_t sps, float mvPerCount, void (*emit)(const CaptureChunk &c))
+{
+    w.emit = emit;
+    w.sps = sps;
+    w.mvPerCount = mvPerCount;
+    w.len = 0;
+    w.samples = 0;
+    w.chunks = 0;
+    capHeader(w);
+}
+
+// Close the open chunk, if any
+inline void capFlush(CaptureWriter &w)
+{
+    if (w.len == 0)
+    {
+        return;
+    }
+    capEmit(w, CAP_SAMPLES, w.payload, w.len);
+    w.len = 0;
+    if (++w.sinceHeader >= CAP_HEADER_EVERY)
+    {
+        capHeader(w);
+    }
+}
+
+// Record one conversion
+inline void capAdd(CaptureWriter &w, uint32_t us, int16_t counts)
+{
+    if (w.len == 0)
+    {
+        capPut32(w.payload, us);
+        w.payload[4] = counts;
+        w.payload[5] = (uint16_t)counts >> 8;
+        w.len = 6;
+        w.lastStep = 0;
+    }
+    else
+    {
+        int32_t step = us - w.lastUs;
+        w.len += capPutVarint(w.payload + w.len, capZigzag(step - w.lastStep));
+        w.len += capPutVarint(w.payload + w.len, capZigzag(counts - w.lastCounts));
+        w.lastStep = step;
+    }
+    w.lastUs = us;
+    w.lastCounts = counts;
+    w.samples++;
+    if (w.len > CAP_PAYLOAD_MAX - 8) // no room for a worst case conversion
+    {
+        capFlush(w);
+    }
+}
+
+// AdcSource that records every conversion it passes on
+class CaptureAdc : public AdcSource
+{
+public:
+    CaptureAdc(AdcSource &src, Clock &clock, CaptureWriter &w) : _src(src), _clock(clock), _w(w) {}
+
+    bool take(int16_t &counts) override
+    {
+        if (!_src.take(counts))
+        {
+            return false;
+        }
+        capAdd(_w, _clock.micros(), counts);
+        return true;
+    }
+
+    int16_t next() override
+    {
+        int16_t counts = _src.next();
+        capAdd(_w, _clock.micros(), counts);
+        return counts;
+    }
+
+    float mvPerCount() const override { return _src.mvPerCount(); }
+    uint32_t periodUs() const override { return _src.periodUs(); }
+
+private:
+    AdcSource &_src;
+    Clock &_clock;
+    CaptureWriter &_w;
+};
+
+// Reading side, for the host tools
+struct CaptureSample
+{
+    uint64_t us; // micros() with its 32 bit wraps unrolled
+    int16_t counts;
+};
+
+struct CaptureReader
+{
+    uint16_t sps = 0;
+    float mvPerCount = 0;
+    uint32_t chunks = 0;    // good chunks
+    uint32_t badCrc = 0;    // framed chunks that failed the CRC
+    uint32_t skipped = 0;   // bytes outside any chunk
+    uint64_t wraps = 0;     // micros() wraps seen, in us
+    uint32_t lastUs = 0;
+    bool any = false;
+};
+
+// Decode one chunk at p (sync already matched), n bytes available.  Returns the
+// chunk length, 0 if more bytes are needed, -1 if it is not a valid chunk.
+template <typename Out>
+int capDecodeChunk(CaptureReader &r, const uint8_t *p, size_t n, Out &out)
+{
+    if (n < 6)
+    {
+        return 0;
+    }
+    uint8_t type = p[2];
+    uint8_t len = p[3];
+    if (len > CAP_PAYLOAD_MAX || (type != CAP_HEADER && type != CAP_SAMPLES))
+    {
+        return -1;
+    }
+    if (n < (size_t)len + 6)
+    {
+        return 0;
+    }
+    uint16_t crc = p[4 + len] | (p[5 + len] << 8);
+    if (crc16(p + 2, len + 2) != crc)
+    {
+        r.badCrc++;
+        return -1;
+    }
+    const uint8_t *q = p + 4;
+    const uint8_t *end = q + len;
+    if (type == CAP_HEADER)
+    {
+        if (len >= 7 && q[0] == CAP_VERSION)
+        {
+            uint32_t mv = capGet32(q + 3);
+            r.sps = q[1] | (q[2] << 8);
+            memcpy(&r.mvPerCount, &mv, 4);
+        }
+    }
+    else if (len >= 6)
+    {
+        uint32_t us = capGet32(q);
+        int16_t counts = (int16_t)(q[4] | (q[5] << 8));
+        int32_t step = 0;
+        q += 6;
+        for (;;)
+        {
+            if (r.any && us < r.lastUs)
+            {
+                r.wraps += 1ULL << 32;
+            }
+            r.lastUs = us;
+            r.any = true;
+            out.push_back(CaptureSample{r.wraps + us, counts});
+            if (q >= end)
+            {
+                break;
+            }
+            uint32_t v[2] = {0, 0};
+            for (int k = 0; k < 2; k++)
+            {
+                for (uint8_t shift = 0; q < end && shift < 35; shift += 7)
+                {
+                    v[k] |= (uint32_t)(*q & 0x7F) << shift;
+                    if (!(*q++ & 0x80))
+                    {
+                        break;
+                    }
+                }
+            }
+            step += capUnzigzag(v[0]);
+            us += step;
+            counts += capUnzigzag(v[1]);
+        }
+    }
+    r.chunks++;
+    return len + 6;
+}
+
+// Decode a whole capture, skipping anything that is not a good chunk.  Out is a
+// container of CaptureSample with push_back().
+template <typename Out>
+void capDecode(CaptureReader &r, const uint8_t *data, size_t n, Out &out)
+{
+    size_t i = 0;
+    while (i + 1 < n)
+    {
+        if (data[i] == CAP_SYNC0 && data[i + 1] == CAP_SYNC1)
+        {
+            int used = capDecodeChunk(r, data + i, n - i, out);
+            if (used > 0)
+            {
+                i += used;
+                continue;
+            }
+            if (used == 0)
+            {
+                break; // truncated at the end
+            }
+        }
+        r.skipped++;
+        i++;
+    }
+}
@@ -0,0 +1,25 @@
+/*
+ *  CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ *
+ *  Bitwise, no table, for short records where 512 bytes of flash for a table
+ *  are not worth it.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+inline uint16_t crc16(const void *data, size_t len, uint16_t crc = 0xFFFF)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    while (len--)
+    {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
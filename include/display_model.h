@@ -0,0 +1,126 @@
+/*
+ *  Display model
+ *
+ *  What the screen shows, as opposed to what was measured: every value held at
+ *  its displayed precision (O2, mV, battery and the estimate band to 0.1, the
+ *  MODs as whole feet or metres), so the UI can tell whether a new reading
+ *  changes anything on screen before it touches SPI.  A shown value only moves
+ *  to the next step once the reading is DM_HYST of a step past the rounding
+ *  point, so noise across a boundary does not flip the last digit back and
+ *  forth.  The MODs are taken with the O2 they belong to, and the gauge dial
+ *  angle follows the shown O2.  dmUpdate() returns which parts changed.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "pipeline.h"
+
+#ifndef DM_HYST
+#define DM_HYST 0.2 // fraction of a display step past the rounding point before a value moves
+#endif
+
+#define DM_STEP 0.1f // O2, mV, V and the band are shown to one decimal
+
+// Parts of the screen dmUpdate() reports as changed
+#define DM_O2      0x01 // O2 value, its colour, and the gauge dial
+#define DM_MOD     0x02
+#define DM_STABLE  0x04
+#define DM_BAND    0x08 // estimate band while predicting
+#define DM_SENSOR  0x10 // sensor mV
+#define DM_BATTERY 0x20 // battery V
+#define DM_ALL     0x3F
+
+// A value held in whole display steps
+struct QuantValue
+{
+    int32_t q = 0;
+    bool valid = false;
+};
+
+// Move to the step x rounds to once it is clear of the hysteresis band.
+// Returns true when the shown step changed.
+inline bool quantUpdate(QuantValue &v, float x, float step, float hyst = DM_HYST)
+{
+    float s = x / step;
+    if (v.valid && fabsf(s - v.q) <= 0.5f + hyst)
+    {
+        return false;
+    }
+    int32_t q = lroundf(s);
+    bool changed = !v.valid || q != v.q;
+    v.q = q;
+    v.valid = true;
+    return changed;
+}
+
+struct DisplayModel
+{
+    QuantValue o2;
+    QuantValue mV;
+    QuantValue batV;
+    QuantValue band;
+    int mod14fsw = 0;
+    int mod14msw = 0;
+    int mod16fsw = 0;
+    int mod16msw = 0;
+    bool stable = false;
+    bool predicting = false;
+    bool valid = false;
+};
+
+// The screen was cleared: everything counts as changed on the next update
+inline void dmInvalidate(DisplayModel &m)
+{
+    m.o2.valid = m.mV.valid = m.batV.valid = m.band.valid = false;
+    m.valid = false;
+}
+
+inline float dmO2(const DisplayModel &m) { return m.o2.q * DM_STEP; }
+inline float dmMv(const DisplayModel &m) { return m.mV.q * DM_STEP; }
+inline float dmBatV(const DisplayModel &m) { return m.batV.q * DM_STEP; }
+inline float dmBand(const DisplayModel &m) { return m.band.q * DM_STEP; }
+
+// Take a reading, returns the DM_ parts whose shown value changed
+inline uint8_t dmUpdate(DisplayModel &m, const Reading &rd)
+{
+    uint8_t changed = m.valid ? 0 : DM_ALL;
+
+    if (quantUpdate(m.o2, rd.o2, DM_STEP) || rd.predicting != m.predicting)
+    {
+        changed |= DM_O2;
+    }
+    m.predicting = rd.predicting;
+    if (changed & DM_O2)
+    {
+        if (rd.mod14fsw != m.mod14fsw || rd.mod16fsw != m.mod16fsw || rd.mod14msw != m.mod14msw ||
+            rd.mod16msw != m.mod16msw)
+        {
+            changed |= DM_MOD;
+        }
+        m.mod14fsw = rd.mod14fsw;
+        m.mod14msw = rd.mod14msw;
+        m.mod16fsw = rd.mod16fsw;
+        m.mod16msw = rd.mod16msw;
+    }
+    if (rd.stable != m.stable)
+    {
+        changed |= DM_STABLE;
+        m.stable = rd.stable;
+    }
+    if (quantUpdate(m.band, rd.predicting ? rd.band : 0, DM_STEP))
+    {
+        changed |= DM_BAND;
+    }
+    if (quantUpdate(m.mV, rd.mV, DM_STEP))
+    {
+        changed |= DM_SENSOR;
+    }
+    if (quantUpdate(m.batV, rd.batV, DM_STEP))
+    {
+        changed |= DM_BATTERY;
+    }
+    m.valid = true;
+    return changed;
+}
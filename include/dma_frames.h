@@ -0,0 +1,182 @@
+/*
+ *  Double buffered sprite push over SPI DMA
+ *
+ *  Two sprites of the same size, whole frames or strips of one: the UI draws
+ *  the next into one while the other is still streaming out to the panel, so
+ *  each costs the longer of drawing and the SPI transfer instead of both one
+ *  after the other.  push() only waits for the transfer before it (there is
+ *  one SPI bus), starts its own and hands back the other sprite.  If the second
+ *  sprite does not fit in RAM it runs on one: draw() then waits for that sprite
+ *  to finish streaming.
+ *
+ *  A 4 bpp sprite (palette.h) cannot go to the panel as it is.  push() expands
+ *  it FRAMES_LINE_ROWS rows at a time into two small RGB565 line buffers, one
+ *  filled while the other streams, so a single sprite is enough: it is free
+ *  again as soon as push() returns.
+ *
+ *  TFT_eSPI has DMA on the ESP32 boards, the SAMD boards push blocking from
+ *  one sprite and TFT_eSPI expands the palette on the way.  With DMA,
+ *  initDma() must run on the core that pushes.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <TFT_eSPI.h>
+#include "palette.h"
+
+#if defined(ESP32)
+#define FRAMES_DMA 1
+#else
+#define FRAMES_DMA 0
+#endif
+
+#ifndef FRAMES_LINE_ROWS
+#define FRAMES_LINE_ROWS 4 // rows per line buffer when expanding a 4 bpp sprite
+#endif
+
+class DmaFrames
+{
+public:
+    DmaFrames(TFT_eSPI &tft) : _tft(tft), _a(&tft), _b(&tft) {}
+
+    // Create the sprites, false if not even one fits.  bpp 4 takes a
+    // PALETTE_SIZE colour palette, drawing into the sprite then takes indices.
+    bool begin(int16_t w, int16_t h, uint8_t bpp = 16, const uint16_t *palette = nullptr)
+    {
+        _a.setColorDepth(bpp);
+        if (!_a.createSprite(w, h))
+        {
+            return false;
+        }
+        _back = 0;
+        _indexed = (bpp == 4);
+        if (_indexed)
+        {
+            _a.createPalette(palette, PALETTE_SIZE);
+            _count = 1;
+#if FRAMES_DMA
+            paletteSwapped(palette, _lut);
+            size_t bytes = (size_t)w * FRAMES_LINE_ROWS * sizeof(uint16_t);
+            _line[0] = (uint16_t *)malloc(bytes);
+            _line[1] = (uint16_t *)malloc(bytes);
+            if (!_line[0] || !_line[1])
+            {
+                free(_line[0]);
+                free(_line[1]);
+                _line[0] = _line[1] = nullptr; // push blocking instead
+            }
+#endif
+            return true;
+        }
+        _b.setColorDepth(bpp);
+        _count = (FRAMES_DMA && _b.createSprite(w, h)) ? 2 : 1;
+        return true;
+    }
+
+    bool initDma()
+    {
+#if FRAMES_DMA
+        return _tft.initDMA();
+#else
+        return false;
+#endif
+    }
+
+    uint8_t count() const { return _count; }
+    TFT_eSprite &sprite(uint8_t i) { return i ? _b : _a; }
+
+    // The sprite to draw the next frame or strip in, free of any transfer
+    TFT_eSprite &draw()
+    {
+        if (_count == 1 && !_indexed)
+        {
+            wait();
+        }
+        return sprite(_back);
+    }
+
+    // Send what was drawn to x, y on the panel and move on to the other sprite
+    void push(int32_t x, int32_t y)
+    {
+        TFT_eSprite &s = sprite(_back);
+#if FRAMES_DMA
+        if (_pending && _tft.dmaBusy())
+        {
+            waits++;
+        }
+        if (_indexed)
+        {
+            if (_line[0])
+            {
+                pushExpanded(s, x, y);
+            }
+            else
+            {
+                wait();
+                s.pushSprite(x, y);
+            }
+            return;
+        }
+        wait();
+        _tft.startWrite();
+        _tft.pushImageDMA(x, y, s.width(), s.height(), (uint16_t *)s.getPointer());
+        _pending = true;
+        _back = (_back + 1) % _count;
+#else
+        s.pushSprite(x, y);
+#endif
+    }
+
+    // Last transfer done and the bus released
+    void wait()
+    {
+#if FRAMES_DMA
+        if (_pending)
+        {
+            _tft.dmaWait();
+            _tft.endWrite();
+            _pending = false;
+        }
+#endif
+    }
+
+    uint32_t waits = 0; // pushes that found the frame before still on the bus
+
+private:
+#if FRAMES_DMA
+    // Expand the next rows while the ones before stream out.  A line buffer is
+    // refilled two transfers after it was sent, and each transfer only started
+    // once the one before it had finished.
+    void pushExpanded(TFT_eSprite &s, int32_t x, int32_t y)
+    {
+        int16_t w = s.width();
+        int16_t h = s.height();
+        const uint8_t *src = (const uint8_t *)s.getPointer();
+        for (int16_t row = 0; row < h; row += FRAMES_LINE_ROWS)
+        {
+            int16_t rows = (h - row < FRAMES_LINE_ROWS) ? h - row : FRAMES_LINE_ROWS;
+            uint16_t *line = _line[_lineBack];
+            paletteExpand(src + (size_t)row * w / 2, line, (uint32_t)rows * w, _lut);
+            wait();
+            _tft.startWrite();
+            _tft.pushImageDMA(x, y + row, w, rows, line);
+            _pending = true;
+            _lineBack ^= 1;
+        }
+    }
+#endif
+
+    TFT_eSPI &_tft;
+    TFT_eSprite _a;
+    TFT_eSprite _b;
+    uint8_t _count = 0;
+    uint8_t _back = 0;
+    bool _indexed = false;
+    bool _pending = false;
+#if FRAMES_DMA
+    uint16_t _lut[PALETTE_SIZE]; // palette in the sprite's byte order
+    uint16_t *_line[2] = {nullptr, nullptr};
+    uint8_t _lineBack = 0;
+#endif
+};
@@ -0,0 +1,59 @@
+/*
+ *  Double-buffered state handoff
+ *
+ *  One writer publishes a complete state, one reader takes the newest.  A
+ *  sequence number counts twice per publish: odd while the writer fills the
+ *  back buffer, even again once it is complete, and the front buffer is
+ *  _buf[(seq / 2) & 1].  The reader copies the front buffer and keeps the copy
+ *  only if no further publish completed meanwhile: the publish after that one
+ *  writes into the buffer being copied, and its odd store is fenced ahead of
+ *  its writes, so a reader that saw any of them also sees the sequence move.
+ *  The writer never waits, and a reader that loses the race copies again.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T>
+class DoubleBuffer
+{
+public:
+    // Writer side
+    void write(const T &v)
+    {
+        uint32_t seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq + 1, std::memory_order_relaxed); // writing
+        std::atomic_thread_fence(std::memory_order_release);
+        _buf[((seq >> 1) + 1) & 1] = v;
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // Reader side.  Returns false if nothing was published since seen.
+    bool read(T &v, uint32_t &seen)
+    {
+        uint32_t seq = _seq.load(std::memory_order_acquire);
+        for (;;)
+        {
+            uint32_t pub = seq >> 1;
+            if (pub == seen)
+            {
+                return false;
+            }
+            v = _buf[pub & 1];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint32_t now = _seq.load(std::memory_order_relaxed);
+            if ((now >> 1) == pub)
+            {
+                seen = pub;
+                return true;
+            }
+            seq = now; // republished while copying, take the newer one
+        }
+    }
+
+private:
+    T _buf[2];
+    std::atomic<uint32_t> _seq{0};
+};
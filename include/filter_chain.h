@@ -0,0 +1,133 @@
+/*
+ *  Compile-time filter chain
+ *
+ *  FilterChain<Median<5>, Ema<2>, Window<8>> runs each sample through the stages
+ *  left to right.  Everything is resolved at compile time: stage state lives inside
+ *  the chain object (no heap), and the calls inline down to straight-line code.
+ *
+ *  Samples are int32 ADC counts scaled by 2^FILTER_FRAC, so the EMA and window
+ *  keep sub-count resolution without float on FPU-less boards.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "ring_buffer.h"
+
+#define FILTER_FRAC 8   // fractional bits carried through the chain
+
+inline int32_t filterIn(int32_t counts) { return counts * (1 << FILTER_FRAC); }
+inline float filterToFloat(int32_t v) { return (float)v / (1 << FILTER_FRAC); }
+
+// Spike rejection: median of the last N samples (N odd, small)
+template <uint8_t N>
+class Median
+{
+    static_assert((N & 1) && N <= 9, "Median<N> needs a small odd N");
+
+public:
+    int32_t apply(int32_t x)
+    {
+        _buf[_idx] = x;
+        _idx = (_idx + 1 == N) ? 0 : _idx + 1;
+        if (_cnt < N)
+        {
+            _cnt++;
+        }
+
+        // insertion sort of a copy, N is tiny
+        int32_t s[N];
+        for (uint8_t i = 0; i < _cnt; i++)
+        {
+            int32_t v = _buf[i];
+            uint8_t j = i;
+            while (j > 0 && s[j - 1] > v)
+            {
+                s[j] = s[j - 1];
+                j--;
+            }
+            s[j] = v;
+        }
+        return s[_cnt / 2];
+    }
+
+    void reset() { _idx = _cnt = 0; }
+
+private:
+    int32_t _buf[N];
+    uint8_t _idx = 0;
+    uint8_t _cnt = 0;
+};
+
+// Low-lag smoothing: exponential moving average with alpha = 1 / 2^SHIFT
+template <uint8_t SHIFT>
+class Ema
+{
+    static_assert(SHIFT >= 1 && SHIFT <= 7, "Ema<SHIFT> alpha must be 1/2 .. 1/128");
+
+public:
+    int32_t apply(int32_t x)
+    {
+        if (!_primed)
+        {
+            _acc = x * (1 << SHIFT);
+            _primed = true;
+        }
+        _acc += x - (_acc >> SHIFT);
+        return _acc >> SHIFT;
+    }
+
+    void reset() { _primed = false; }
+
+private:
+    int32_t _acc = 0;
+    bool _primed = false;
+};
+
+// Boxcar average of the last N samples, O(1) per sample from a running sum
+template <uint8_t N>
+class Window
+{
+    static_assert(N <= 128, "Window<N> sum must fit in int32");
+
+public:
+    int32_t apply(int32_t x)
+    {
+        _buf.addValue(x);
+        return _buf.average();
+    }
+
+    void reset() { _buf.clear(); }
+
+private:
+    RingBuffer<int32_t, N> _buf;
+};
+
+template <typename... Stages>
+class FilterChain;
+
+// End of the chain
+template <>
+class FilterChain<>
+{
+public:
+    int32_t apply(int32_t x) { return x; }
+    void reset() {}
+};
+
+template <typename First, typename... Rest>
+class FilterChain<First, Rest...>
+{
+public:
+    int32_t apply(int32_t x) { return _rest.apply(_first.apply(x)); }
+
+    void reset()
+    {
+        _first.reset();
+        _rest.reset();
+    }
+
+private:
+    First _first;
+    FilterChain<Rest...> _rest;
+};
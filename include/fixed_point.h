@@ -0,0 +1,39 @@
+/*
+ *  Fixed-point helpers for boards without a hardware FPU
+ *
+ *  The ESP32-C3 (RISC-V) and SAMD21 (Cortex-M0+) emulate every float operation in
+ *  software.  The sample path keeps raw ADC counts as integers and does the gas math
+ *  in Q16.16, with Q8.24 for small factors such as calFactor (0.05 - 0.5) where
+ *  Q16.16 would not hold enough significant bits.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef int32_t q16_t; // Q16.16
+typedef int32_t q24_t; // Q8.24
+
+#define Q16_ONE ((q16_t)1 << 16)
+#define Q24_ONE ((q24_t)1 << 24)
+
+// Constants only; rounds to nearest
+constexpr q16_t q16(double v) { return (q16_t)(v * Q16_ONE + (v < 0 ? -0.5 : 0.5)); }
+constexpr q24_t q24(double v) { return (q24_t)(v * Q24_ONE + (v < 0 ? -0.5 : 0.5)); }
+
+inline q16_t q16FromInt(int32_t v) { return (q16_t)(v * Q16_ONE); }
+inline float q16ToFloat(q16_t v) { return (float)v / Q16_ONE; }
+inline q16_t q16FromFloat(float v) { return (q16_t)(v * Q16_ONE); }
+
+// Q16.16 x Q8.24 -> Q16.16
+inline q16_t q16MulQ24(q16_t a, q24_t b) { return (q16_t)(((int64_t)a * b) >> 24); }
+
+// Round to tenths (for display) without going through float
+inline int32_t q16ToTenths(q16_t v) { return (int32_t)(((int64_t)v * 10 + (Q16_ONE / 2)) >> 16); }
+
+// Floor division, as floor() does on the float path for negative values
+inline int32_t floorDiv(int32_t num, int32_t den)
+{
+    int32_t q = num / den;
+    return ((num % den != 0) && ((num < 0) != (den < 0))) ? q - 1 : q;
+}
@@ -0,0 +1,59 @@
+/*
+ *  O2 and MOD math
+ *
+ *  Float path for boards with an FPU, and the equivalent fixed-point path
+ *  (FIXED_MATH) for the ESP32-C3 and SAMD21 boards.  test/test_fixed_point checks
+ *  that the two agree.
+ */
+
+#pragma once
+
+#include <math.h>
+#include "fixed_point.h"
+
+#define O2_AIR        20.9   // calibration point, % O2 in air
+#define O2_MAX        99.9   // display limit
+
+// ---- Float path -------------------------------------------------------------
+
+// calFactor converts averaged ADC counts to % O2
+inline float calFactorFor(float aveCounts)
+{
+    return (1 / aveCounts * O2_AIR);
+}
+
+inline float o2FromCounts(float aveCounts, float calFactor)
+{
+    float o2 = aveCounts * calFactor; // Units: pct
+    return (o2 > O2_MAX) ? O2_MAX : o2;
+}
+
+// Maximum operating depth for a ppO2 limit; unitsPerBar is 33 for fsw, 10 for msw
+inline int modDepth(float o2, float ppo, int unitsPerBar)
+{
+    return floor(unitsPerBar * ((ppo / (o2 / 100)) - 1));
+}
+
+// ---- Fixed-point path -------------------------------------------------------
+
+// 20.9 / (sum / count), straight from integer sums of raw counts
+inline q24_t calFactorQ24(int32_t sum, uint16_t count)
+{
+    return (q24_t)(((int64_t)q24(O2_AIR) * count) / sum);
+}
+
+inline q16_t o2FromCountsQ16(q16_t aveCounts, q24_t calFactor)
+{
+    q16_t o2 = q16MulQ24(aveCounts, calFactor);
+    return (o2 > q16(O2_MAX)) ? q16(O2_MAX) : o2;
+}
+
+// unitsPerBar * (ppo / (o2 / 100) - 1) == unitsPerBar * (100 * ppo - o2) / o2
+inline int modDepthQ16(q16_t o2, q16_t ppo, int unitsPerBar)
+{
+    if (o2 <= 0)
+    {
+        return 0;
+    }
+    return floorDiv(unitsPerBar * (100 * ppo - o2), o2);
+}
@@ -0,0 +1,89 @@
+/*
+ *  Hardware abstraction layer
+ *
+ *  The few things the analyser needs from the board, as small interfaces: the O2
+ *  ADC, the display, the battery monitor, the button and the clock.  The firmware
+ *  binds them to the real parts in hal_arduino.h, the host build to the simulated
+ *  parts in hal_sim.h, so acquisition, calibration, gas math and the text UI run
+ *  unchanged on a dev box.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// RGB565 colours the UI uses, same values as TFT_eSPI (which defines them on target)
+#ifndef TFT_BLACK
+#define TFT_BLACK       0x0000
+#define TFT_DARKGREEN   0x03E0
+#define TFT_DARKCYAN    0x03EF
+#define TFT_LIGHTGREY   0xD69A
+#define TFT_BLUE        0x001F
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_RED         0xF800
+#define TFT_MAGENTA     0xF81F
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_GOLD        0xFEA0
+#define TFT_SILVER      0xC618
+#define TFT_SKYBLUE     0x867D
+#endif
+
+// O2 sensor ADC, one conversion at a time at a fixed data rate
+class AdcSource
+{
+public:
+    virtual ~AdcSource() {}
+    virtual bool take(int16_t &counts) = 0; // next conversion if one is ready, never waits
+    virtual int16_t next() = 0;             // next conversion, waits for it
+    virtual float mvPerCount() const = 0;
+    virtual uint32_t periodUs() const = 0;  // conversion period
+};
+
+// The subset of TFT_eSPI the UI draws with
+class DisplaySurface
+{
+public:
+    virtual ~DisplaySurface() {}
+    virtual int16_t width() = 0;
+    virtual int16_t height() = 0;
+    virtual void fillScreen(uint16_t color) = 0;
+    virtual void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) = 0;
+    virtual void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) = 0;
+    virtual void setTextColor(uint16_t fg) = 0;              // transparent background
+    virtual void setTextColor(uint16_t fg, uint16_t bg) = 0; // background filled
+    virtual void setTextSize(uint8_t size) = 0;
+    virtual void setTextPadding(uint16_t px) = 0;
+    virtual int16_t textWidth(const char *s, uint8_t font) = 0;
+    virtual int16_t fontHeight(uint8_t font) = 0;
+    virtual void drawString(const char *s, int32_t x, int32_t y, uint8_t font) = 0;
+    virtual void drawCentreString(const char *s, int32_t x, int32_t y, uint8_t font) = 0;
+};
+
+class BatteryMonitor
+{
+public:
+    virtual ~BatteryMonitor() {}
+    virtual float volts() = 0;
+    virtual bool present() { return true; } // false: no monitor, volts() means nothing
+};
+
+class Button
+{
+public:
+    virtual ~Button() {}
+    virtual void begin() = 0;
+    virtual bool pressed() = 0;
+};
+
+class Clock
+{
+public:
+    virtual ~Clock() {}
+    virtual uint32_t millis() = 0;
+    virtual uint32_t micros() = 0;
+    virtual void sleepMs(uint32_t ms) = 0;
+};
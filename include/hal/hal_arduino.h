@@ -0,0 +1,100 @@
+/*
+ *  HAL backends for the boards
+ *
+ *  Thin forwarding wrappers over the sampler, TFT_eSPI, batStat() and the GPIO, so
+ *  the firmware reaches the hardware through the same interfaces the host build
+ *  simulates.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "hal.h"
+#include "sampler.h"
+
+// Conversions from the ADS1115 sampler
+class SamplerAdc : public AdcSource
+{
+public:
+    SamplerAdc(Sampler &s) : _s(s) {}
+
+    bool take(int16_t &counts) override
+    {
+        samplerPoll(_s);
+        return samplerTake(_s, counts);
+    }
+
+    int16_t next() override { return samplerNext(_s); }
+    float mvPerCount() const override { return _s.ads->multiplier; }
+    uint32_t periodUs() const override { return _s.periodUs; }
+
+private:
+    Sampler &_s;
+};
+
+// Works for the panel and for sprites, TFT_eSprite is a TFT_eSPI
+class TftSurface : public DisplaySurface
+{
+public:
+    TftSurface(TFT_eSPI &t) : _t(t) {}
+
+    int16_t width() override { return _t.width(); }
+    int16_t height() override { return _t.height(); }
+    void fillScreen(uint16_t color) override { _t.fillScreen(color); }
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) override { _t.fillRect(x, y, w, h, color); }
+    void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) override { _t.drawRect(x, y, w, h, color); }
+    void setTextColor(uint16_t fg) override { _t.setTextColor(fg); }
+    void setTextColor(uint16_t fg, uint16_t bg) override { _t.setTextColor(fg, bg); }
+    void setTextSize(uint8_t size) override { _t.setTextSize(size); }
+    void setTextPadding(uint16_t px) override { _t.setTextPadding(px); }
+    int16_t textWidth(const char *s, uint8_t font) override { return _t.textWidth(s, font); }
+    int16_t fontHeight(uint8_t font) override { return _t.fontHeight(font); }
+    void drawString(const char *s, int32_t x, int32_t y, uint8_t font) override { _t.drawString(s, x, y, font); }
+    void drawCentreString(const char *s, int32_t x, int32_t y, uint8_t font) override { _t.drawCentreString(s, x, y, font); }
+
+private:
+    TFT_eSPI &_t;
+};
+
+// Battery divider on the ESP32 ADC, see bat_stat.h
+class BoardBattery : public BatteryMonitor
+{
+public:
+    float volts() override
+    {
+#ifdef ESP32
+        return (batStat() / 1000) * BAT_ADJ;
+#else
+        return 0; // no battery monitor on the SAMD boards
+#endif
+    }
+
+    bool present() override
+    {
+#ifdef ESP32
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+class PinButton : public Button
+{
+public:
+    PinButton(int pin) : _pin(pin) {}
+    void begin() override { pinMode(_pin, INPUT); }
+    bool pressed() override { return digitalRead(_pin) == LOW; } // must be LOW for TTGO OI
+
+private:
+    int _pin;
+};
+
+class ArduinoClock : public Clock
+{
+public:
+    uint32_t millis() override { return ::millis(); }
+    uint32_t micros() override { return ::micros(); }
+    void sleepMs(uint32_t ms) override { delay(ms); }
+};
@@ -0,0 +1,335 @@
+/*
+ *  Simulated HAL backends for the host build
+ *
+ *  Virtual time: nothing sleeps, waiting for a conversion just moves the clock to
+ *  it, so a run is fast and repeats exactly.  The ADC is either a fixed input or
+ *  a capture from a unit replayed at its recorded times.  The display is an
+ *  RGB565 frame buffer that also keeps the strings drawn on it, so a run can be
+ *  checked from the text on screen or written out as an image.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "hal.h"
+#include "capture.h"
+
+class SimClock : public Clock
+{
+public:
+    uint32_t millis() override { return (uint32_t)(_us / 1000); }
+    uint32_t micros() override { return (uint32_t)_us; }
+    void sleepMs(uint32_t ms) override { _us += ms * 1000ULL; }
+
+    uint64_t nowUs() const { return _us; }
+    void advanceUs(uint64_t us) { _us += us; }
+    void setUs(uint64_t us) { _us = (us > _us) ? us : _us; }
+
+private:
+    uint64_t _us = 0;
+};
+
+// ADS1115 in continuous mode: a conversion every periodUs, only the latest kept
+class SimAdc : public AdcSource
+{
+public:
+    SimAdc(SimClock &clock, uint16_t sps, float mvPerCount)
+        : _clock(clock), _periodUs(1000000UL / sps), _mvPerCount(mvPerCount)
+    {
+        _nextUs = _periodUs;
+    }
+
+    void setMv(double mv) { _mv = mv; }
+    void setNoise(double sdCounts) { _noise = sdCounts; }
+
+    bool take(int16_t &counts) override
+    {
+        uint64_t now = _clock.nowUs();
+        if (now < _nextUs)
+        {
+            return false;
+        }
+        uint64_t late = (now - _nextUs) / _periodUs; // older results were overwritten
+        missed += late;
+        _nextUs += (late + 1) * _periodUs;
+        counts = convert(sensorMv(_nextUs - _periodUs));
+        count++;
+        return true;
+    }
+
+    int16_t next() override
+    {
+        int16_t counts;
+        _clock.setUs(_nextUs);
+        take(counts);
+        return counts;
+    }
+
+    float mvPerCount() const override { return _mvPerCount; }
+    uint32_t periodUs() const override { return _periodUs; }
+
+    uint64_t count = 0;  // conversions read
+    uint64_t missed = 0; // conversions overwritten before they were read
+
+protected:
+    // Sensor output at a point in time, overridden by the sensor model
+    virtual double sensorMv(uint64_t /* us */) { return _mv; }
+
+    int16_t convert(double mv)
+    {
+        double c = mv / _mvPerCount + _noise * gauss();
+        c = (c > 32767) ? 32767 : (c < -32768) ? -32768 : c;
+        return (int16_t)lround(c);
+    }
+
+    // Deterministic normal deviates, xorshift32 + Box-Muller
+    double gauss()
+    {
+        double u1 = (rnd() + 1.0) / 4294967297.0;
+        double u2 = (rnd() + 1.0) / 4294967297.0;
+        return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+    }
+
+    uint32_t rnd()
+    {
+        _seed ^= _seed << 13;
+        _seed ^= _seed >> 17;
+        _seed ^= _seed << 5;
+        return _seed;
+    }
+
+    SimClock &_clock;
+    uint32_t _periodUs;
+    float _mvPerCount;
+    uint64_t _nextUs;
+    double _mv = 0;
+    double _noise = 0;
+    uint32_t _seed = 0x2545F491;
+};
+
+// Conversions from a capture (capture.h), at their recorded times.  The first one
+// lands one period in, like the first conversion of SimAdc.
+class ReplayAdc : public AdcSource
+{
+public:
+    ReplayAdc(SimClock &clock, const std::vector<CaptureSample> &samples, uint16_t sps, float mvPerCount)
+        : _clock(clock), _samples(samples), _periodUs(sps ? 1000000UL / sps : 0), _mvPerCount(mvPerCount)
+    {
+        _baseUs = samples.empty() ? 0 : samples[0].us - _periodUs;
+    }
+
+    bool take(int16_t &counts) override
+    {
+        if (done() || _samples[_idx].us - _baseUs > _clock.nowUs())
+        {
+            return false;
+        }
+        counts = _samples[_idx++].counts;
+        return true;
+    }
+
+    // Past the end the last conversion repeats, one period apart
+    int16_t next() override
+    {
+        if (done())
+        {
+            _clock.advanceUs(_periodUs ? _periodUs : 1000);
+            return _samples.empty() ? 0 : _samples.back().counts;
+        }
+        _clock.setUs(_samples[_idx].us - _baseUs);
+        return _samples[_idx++].counts;
+    }
+
+    float mvPerCount() const override { return _mvPerCount; }
+    uint32_t periodUs() const override { return _periodUs; }
+
+    bool done() const { return _idx >= _samples.size(); }
+    size_t position() const { return _idx; }
+
+private:
+    SimClock &_clock;
+    const std::vector<CaptureSample> &_samples;
+    uint32_t _periodUs;
+    float _mvPerCount;
+    uint64_t _baseUs;
+    size_t _idx = 0;
+};
+
+class SimBattery : public BatteryMonitor
+{
+public:
+    float volts() override { return v; }
+    float v = 3.9;
+};
+
+class SimButton : public Button
+{
+public:
+    void begin() override {}
+    bool pressed() override { return down; }
+    bool down = false;
+};
+
+// Frame buffer with the strings on it.  Glyphs are not rasterised, a string fills
+// its background box and is kept in the text list at its anchor.
+class MemorySurface : public DisplaySurface
+{
+public:
+    struct Text
+    {
+        int32_t x, y;     // anchor: left, or centre for centred strings
+        uint8_t font;
+        uint16_t color;
+        std::string s;
+    };
+
+    MemorySurface(int16_t w, int16_t h) : _w(w), _h(h), _fb(w * h, TFT_BLACK) {}
+
+    int16_t width() override { return _w; }
+    int16_t height() override { return _h; }
+
+    void fillScreen(uint16_t color) override
+    {
+        std::fill(_fb.begin(), _fb.end(), color);
+        texts.clear();
+        fills++;
+    }
+
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) override
+    {
+        for (int32_t j = y; j < y + h; j++)
+        {
+            for (int32_t i = x; i < x + w; i++)
+            {
+                plot(i, j, color);
+            }
+        }
+        pixels += (w > 0 && h > 0) ? w * h : 0;
+    }
+
+    void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) override
+    {
+        fillRect(x, y, w, 1, color);
+        fillRect(x, y + h - 1, w, 1, color);
+        fillRect(x, y, 1, h, color);
+        fillRect(x + w - 1, y, 1, h, color);
+    }
+
+    void setTextColor(uint16_t fg) override
+    {
+        _fg = fg;
+        _fill = false;
+    }
+
+    void setTextColor(uint16_t fg, uint16_t bg) override
+    {
+        _fg = fg;
+        _bg = bg;
+        _fill = true;
+    }
+
+    void setTextSize(uint8_t size) override { _size = size ? size : 1; }
+    void setTextPadding(uint16_t px) override { _pad = px; }
+
+    // Average advance of the TFT_eSPI built in fonts
+    int16_t textWidth(const char *s, uint8_t font) override
+    {
+        static const uint8_t adv[9] = {6, 6, 8, 8, 14, 14, 27, 32, 55};
+        return strlen(s) * adv[font < 9 ? font : 1] * _size;
+    }
+
+    int16_t fontHeight(uint8_t font) override
+    {
+        static const uint8_t height[9] = {8, 8, 16, 16, 26, 26, 48, 48, 75};
+        return height[font < 9 ? font : 1] * _size;
+    }
+
+    void drawString(const char *s, int32_t x, int32_t y, uint8_t font) override
+    {
+        text(s, x, y, font, x);
+    }
+
+    void drawCentreString(const char *s, int32_t x, int32_t y, uint8_t font) override
+    {
+        text(s, x, y, font, x - textWidth(s, font) / 2);
+    }
+
+    uint16_t pixel(int32_t x, int32_t y) const { return _fb[y * _w + x]; }
+
+    // Newest string whose anchor is on row band y..y+tol
+    const Text *textNear(int32_t y, int32_t tol = 4) const
+    {
+        for (size_t i = texts.size(); i-- > 0;)
+        {
+            if (texts[i].y >= y - tol && texts[i].y <= y + tol)
+            {
+                return &texts[i];
+            }
+        }
+        return nullptr;
+    }
+
+    bool writePpm(const char *path) const
+    {
+        FILE *f = fopen(path, "wb");
+        if (!f)
+        {
+            return false;
+        }
+        fprintf(f, "P6\n%d %d\n255\n", _w, _h);
+        for (uint16_t c : _fb)
+        {
+            uint8_t rgb[3] = {(uint8_t)((c >> 8) & 0xF8), (uint8_t)((c >> 3) & 0xFC), (uint8_t)(c << 3)};
+            fwrite(rgb, 1, 3, f);
+        }
+        fclose(f);
+        return true;
+    }
+
+    std::vector<Text> texts; // strings on screen, oldest first
+    uint32_t fills = 0;      // fillScreen() calls
+    uint64_t pixels = 0;     // pixels written by fills and rects
+
+private:
+    void plot(int32_t x, int32_t y, uint16_t c)
+    {
+        if (x >= 0 && y >= 0 && x < _w && y < _h)
+        {
+            _fb[y * _w + x] = c;
+        }
+    }
+
+    void text(const char *s, int32_t ax, int32_t y, uint8_t font, int32_t x)
+    {
+        int32_t w = textWidth(s, font);
+        int32_t h = fontHeight(font);
+        if (_fill)
+        {
+            int32_t pw = (_pad > w) ? _pad : w;
+            fillRect(x - (pw - w) / 2, y, pw, h, _bg);
+        }
+        for (size_t i = 0; i < texts.size(); i++) // overdrawn at the same anchor
+        {
+            if (texts[i].x == ax && texts[i].y == y && texts[i].font == font)
+            {
+                texts.erase(texts.begin() + i);
+                break;
+            }
+        }
+        texts.push_back(Text{ax, y, font, _fg, s});
+    }
+
+    int16_t _w, _h;
+    std::vector<uint16_t> _fb;
+    uint16_t _fg = TFT_WHITE;
+    uint16_t _bg = TFT_BLACK;
+    bool _fill = false;
+    uint8_t _size = 1;
+    uint16_t _pad = 0;
+};
@@ -0,0 +1,146 @@
+/*
+ *  Simulated galvanic O2 cell on the ADS1115
+ *
+ *  The cell output is proportional to the O2 partial pressure, so the model is a
+ *  sensitivity in mV per % O2 that follows the gas through a first-order lag
+ *  (t90), plus white and 1/f noise, a slow linear drift and a temperature
+ *  coefficient.  The result goes through the simulated ADC, which quantises it
+ *  at the PGA step and clips at full scale.  A script of gas steps (air, EAN32,
+ *  back to air...) drives the gas and the cell temperature.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+#include "hal_sim.h"
+
+#define SIM_PINK_ROWS 8   // octaves of the 1/f generator
+
+// ADS1115 PGA full scale, volts: GAIN_TWOTHIRDS, ONE, TWO, FOUR, EIGHT, SIXTEEN
+inline float simPgaFullScale(uint8_t pga)
+{
+    static const float fs[6] = {6.144, 4.096, 2.048, 1.024, 0.512, 0.256};
+    return fs[pga < 6 ? pga : 2];
+}
+
+inline float simPgaMvPerCount(uint8_t pga)
+{
+    return simPgaFullScale(pga) * 1000 / 32768;
+}
+
+struct SensorModel
+{
+    float mvPerPct = 10.0 / 20.9; // sensitivity, a 10 mV cell in air
+    float t90S = 6;               // response time to 90 % of a step
+    float whiteMv = 0.02;         // white noise, mV rms
+    float pinkMv = 0.01;          // 1/f noise, mV rms
+    float driftPctH = 0;          // sensitivity drift, % per hour (a cell ageing or settling)
+    float tempCoPct = 0;          // sensitivity change, % per deg C off tempRefC (0 for a compensated cell)
+    float tempRefC = 25;
+    float thermalTauS = 60;       // cell temperature lag behind the script
+    uint8_t pga = 2;              // ADS1115 gain, see simPgaFullScale(), GAIN_TWO as on target
+};
+
+// One scripted change: from atS on, the cell sees o2Pct at tempC
+struct GasStep
+{
+    float atS;
+    float o2Pct;
+    float tempC;
+};
+
+class SimO2Sensor : public SimAdc
+{
+public:
+    SimO2Sensor(SimClock &clock, uint16_t sps, const SensorModel &m)
+        : SimAdc(clock, sps, simPgaMvPerCount(m.pga)), model(m)
+    {
+    }
+
+    // Replace the script.  Steps must be in time order, the first one sets the
+    // starting gas and temperature, the cell starts settled in it.
+    void setScript(const std::vector<GasStep> &steps)
+    {
+        _script = steps;
+        _started = false;
+    }
+
+    // Index of the script step in force at virtual time us
+    size_t stepAt(uint64_t us) const
+    {
+        size_t i = 0;
+        while (i + 1 < _script.size() && _script[i + 1].atS * 1e6 <= us)
+        {
+            i++;
+        }
+        return i;
+    }
+
+    // Gas and temperature the script applies at virtual time us
+    GasStep scriptAt(uint64_t us) const
+    {
+        GasStep air = {0, 20.9, 25};
+        return _script.empty() ? air : _script[stepAt(us)];
+    }
+
+    const std::vector<GasStep> &script() const { return _script; }
+
+    float o2Pct = 20.9;    // % O2 the cell responds to now
+    float cellO2 = 20.9;   // % O2 the cell output currently stands for (lags o2Pct)
+    float tempC = 25;      // cell temperature
+    SensorModel model;
+
+protected:
+    double sensorMv(uint64_t us) override
+    {
+        if (!_started)
+        {
+            GasStep s = scriptAt(us);
+            o2Pct = cellO2 = s.o2Pct;
+            tempC = s.tempC;
+            _lastUs = us;
+            _started = true;
+        }
+        GasStep s = scriptAt(us);
+        o2Pct = s.o2Pct;
+
+        // Exact first-order step over dt, t90 = 2.303 tau
+        double dt = (us - _lastUs) / 1e6;
+        _lastUs = us;
+        double tau = model.t90S / log(10.0);
+        cellO2 += (o2Pct - cellO2) * (tau > 0 ? 1 - exp(-dt / tau) : 1);
+        tempC += (s.tempC - tempC) * (model.thermalTauS > 0 ? 1 - exp(-dt / model.thermalTauS) : 1);
+
+        double sens = model.mvPerPct;
+        sens *= 1 + model.driftPctH / 100 * (us / 3.6e9);
+        sens *= 1 + model.tempCoPct / 100 * (tempC - model.tempRefC);
+
+        return cellO2 * sens + model.whiteMv * gauss() + model.pinkMv * pink();
+    }
+
+    // Voss-McCartney: row k is redrawn every 2^k samples, the sum is close to 1/f
+    double pink()
+    {
+        _pinkN++;
+        uint32_t n = _pinkN;
+        uint8_t k = 0;
+        while (k < SIM_PINK_ROWS - 1 && !(n & 1))
+        {
+            n >>= 1;
+            k++;
+        }
+        _pinkSum -= _pinkRows[k];
+        _pinkRows[k] = gauss();
+        _pinkSum += _pinkRows[k];
+        return _pinkSum / sqrt((double)SIM_PINK_ROWS);
+    }
+
+    std::vector<GasStep> _script;
+    bool _started = false;
+    uint64_t _lastUs = 0;
+    double _pinkRows[SIM_PINK_ROWS] = {0};
+    double _pinkSum = 0;
+    uint32_t _pinkN = 0;
+};
@@ -0,0 +1,170 @@
+/*
+ *  Leveled, tagged logging
+ *
+ *    logE(CAL, "did not settle, drift %s %%/s", LogFloat(cal.driftPct, 3).s);
+ *
+ *  logE/logW/logI/logT log at ERROR, WARN, INFO and TRACE.  The tag names the
+ *  subsystem and picks its threshold, LOG_LEVEL_<tag>, which defaults to
+ *  LOG_LEVEL.  A call above its threshold is a constant false branch: the
+ *  compiler drops it with its format string, and its arguments are never
+ *  evaluated.  A line that passes is formatted there and then into a
+ *  LOG_LINE_MAX buffer on the caller's stack, no String and no heap, and handed
+ *  to the sink as
+ *
+ *    <ms> <E|W|I|T> <tag> <message>\n
+ *
+ *  with its fields alongside, so a sink can filter on them.  Format strings are
+ *  plain literals, which the ESP32 and SAMD boards read in place from flash.
+ *  The SAMD printf has no %f, so floats go through LogFloat and %s.  A tag
+ *  without a LOG_LEVEL_<tag> does not compile.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#define LOG_NONE  0
+#define LOG_ERROR 1 // the unit cannot measure
+#define LOG_WARN  2 // degraded or retried, the reading may be off
+#define LOG_INFO  3 // calibration results and state changes
+#define LOG_TRACE 4 // step by step
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_WARN
+#endif
+
+#ifndef LOG_LINE_MAX
+#define LOG_LINE_MAX 96 // longer lines are cut, the newline is kept
+#endif
+
+// Subsystems
+#ifndef LOG_LEVEL_SYS
+#define LOG_LEVEL_SYS LOG_LEVEL   // start up and tasks
+#endif
+#ifndef LOG_LEVEL_ADC
+#define LOG_LEVEL_ADC LOG_LEVEL   // ADS1115 and the sampler
+#endif
+#ifndef LOG_LEVEL_CAL
+#define LOG_LEVEL_CAL LOG_LEVEL   // calibration and warm start
+#endif
+#ifndef LOG_LEVEL_STAB
+#define LOG_LEVEL_STAB LOG_LEVEL  // settling and stability
+#endif
+#ifndef LOG_LEVEL_UI
+#define LOG_LEVEL_UI LOG_LEVEL    // display and fault screens
+#endif
+#ifndef LOG_LEVEL_CAP
+#define LOG_LEVEL_CAP LOG_LEVEL   // raw capture
+#endif
+#ifndef LOG_LEVEL_SCHED
+#define LOG_LEVEL_SCHED LOG_LEVEL // scheduler job statistics
+#endif
+
+#define LOG_AT(level, threshold, tag, ...)                \
+    do                                                    \
+    {                                                     \
+        if ((level) <= (threshold))                       \
+        {                                                 \
+            logWrite(level, tag, __VA_ARGS__);            \
+        }                                                 \
+    } while (0)
+
+#define logE(tag, ...) LOG_AT(LOG_ERROR, LOG_LEVEL_##tag, #tag, __VA_ARGS__)
+#define logW(tag, ...) LOG_AT(LOG_WARN, LOG_LEVEL_##tag, #tag, __VA_ARGS__)
+#define logI(tag, ...) LOG_AT(LOG_INFO, LOG_LEVEL_##tag, #tag, __VA_ARGS__)
+#define logT(tag, ...) LOG_AT(LOG_TRACE, LOG_LEVEL_##tag, #tag, __VA_ARGS__)
+
+struct LogLine
+{
+    uint32_t ms;
+    uint8_t level;
+    const char *tag;
+    const char *msg;  // the message alone, inside text
+    const char *text; // the whole line, newline terminated
+    uint16_t len;     // of text
+};
+
+struct LogConfig
+{
+    void (*sink)(const LogLine &line) = nullptr; // nothing is formatted without one
+    uint32_t (*clockMs)() = nullptr;             // line time stamp, 0 without one
+};
+
+inline LogConfig &logConfig()
+{
+    static LogConfig config;
+    return config;
+}
+
+inline char logLevelChar(uint8_t level)
+{
+    return "-EWIT"[level <= LOG_TRACE ? level : 0];
+}
+
+inline void logWrite(uint8_t level, const char *tag, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+inline void logWrite(uint8_t level, const char *tag, const char *fmt, ...)
+{
+    const LogConfig &cfg = logConfig();
+    if (!cfg.sink)
+    {
+        return;
+    }
+    char buf[LOG_LINE_MAX];
+    LogLine line;
+    line.ms = cfg.clockMs ? cfg.clockMs() : 0;
+    line.level = level;
+    line.tag = tag;
+    int head = snprintf(buf, sizeof(buf) - 1, "%lu %c %s ", (unsigned long)line.ms, logLevelChar(level), tag);
+    head = (head < (int)sizeof(buf) - 1) ? head : sizeof(buf) - 2;
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + head, sizeof(buf) - 1 - head, fmt, args);
+    va_end(args);
+    n = (n < 0) ? 0 : n;
+    uint16_t len = (head + n < (int)sizeof(buf) - 1) ? head + n : sizeof(buf) - 2;
+    buf[len++] = '\n';
+    buf[len] = '\0';
+
+    line.msg = buf + head;
+    line.text = buf;
+    line.len = len;
+    cfg.sink(line);
+}
+
+// A float as text for %s, formatted only when the line is logged:
+// LogFloat(v, 2).s lives until the end of the log call
+struct LogFloat
+{
+    char s[24];
+
+    LogFloat(float v, uint8_t decimals = 2)
+    {
+        decimals = (decimals < 6) ? decimals : 6;
+        uint32_t scale = 1;
+        for (uint8_t i = 0; i < decimals; i++)
+        {
+            scale *= 10;
+        }
+        bool neg = v < 0;
+        float a = neg ? -v : v;
+        if (!(a * scale < 4.0e9f)) // out of range or NaN
+        {
+            snprintf(s, sizeof(s), "%s", (a == a) ? (neg ? "-inf" : "inf") : "nan");
+            return;
+        }
+        uint32_t n = (uint32_t)(a * scale + 0.5f);
+        if (decimals)
+        {
+            snprintf(s, sizeof(s), "%s%lu.%0*lu", neg && n ? "-" : "", (unsigned long)(n / scale), decimals,
+                     (unsigned long)(n % scale));
+        }
+        else
+        {
+            snprintf(s, sizeof(s), "%s%lu", neg && n ? "-" : "", (unsigned long)n);
+        }
+    }
+};
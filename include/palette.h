@@ -0,0 +1,56 @@
+/*
+ *  Fixed colour palettes for 4 bpp sprites
+ *
+ *  A 4 bpp TFT_eSPI sprite keeps a palette index per pixel, two to a byte with
+ *  the left pixel in the high nibble, and turns them into RGB565 only on the
+ *  way out.  Drawing into one takes the index, not the colour: PALETTE_INDEX()
+ *  looks it up at compile time, and a colour missing from the palette does not
+ *  compile.  paletteExpand() does the way out for a DMA push, a few rows at a
+ *  time, through a table already in the panel's byte order.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define PALETTE_SIZE 16
+
+// Not constexpr: reached only for a colour missing from the palette, which
+// makes the compile time lookup fail
+inline uint8_t paletteMissing() { return 0; }
+
+// Index of colour c in a PALETTE_SIZE entry palette
+constexpr uint8_t paletteIndex(const uint16_t *pal, uint16_t c, uint8_t i = 0)
+{
+    return (i == PALETTE_SIZE) ? paletteMissing() : (pal[i] == c) ? i : paletteIndex(pal, c, i + 1);
+}
+
+template <uint8_t I>
+struct PaletteSlot
+{
+    static constexpr uint8_t index = I;
+};
+
+// Index of a constant colour in a constexpr palette, checked while compiling
+#define PALETTE_INDEX(pal, c) (PaletteSlot<paletteIndex(pal, c)>::index)
+
+// The palette with each colour byte swapped, as sprite buffers hold RGB565
+// (high byte first on the wire)
+inline void paletteSwapped(const uint16_t *pal, uint16_t *lut)
+{
+    for (uint8_t i = 0; i < PALETTE_SIZE; i++)
+    {
+        lut[i] = (uint16_t)((pal[i] >> 8) | (pal[i] << 8));
+    }
+}
+
+// Expand n packed 4 bpp pixels (n even) to 16 bit ones through lut
+inline void paletteExpand(const uint8_t *src, uint16_t *dst, uint32_t n, const uint16_t *lut)
+{
+    for (uint32_t i = 0; i < n; i += 2)
+    {
+        uint8_t b = *src++;
+        *dst++ = lut[b >> 4];
+        *dst++ = lut[b & 0x0F];
+    }
+}
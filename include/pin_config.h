@@ -1,4 +1,10 @@
 // Chip Specific settings to interface battery status and LCD
+// ADS_RDY_PIN is the GPIO wired to the ADS1115 ALERT/RDY output (-1 if not wired).
+//   None of the documented builds connect ALERT/RDY; on an unconnected pin every
+//   wait would end in a timeout.  Set it only once the line is actually wired.
+// ADS_DATA_RATE is the continuous conversion rate, RATE_ADS1115_8SPS .. RATE_ADS1115_860SPS
+// SAMPLE_FILTER is the filter chain (filter_chain.h) tuned to the board's rate and noise
+// FIXED_MATH 1 selects the integer / Q16.16 signal path on chips without an FPU
 
 #if defined(SEEED_XIAO_M0)  // Seeed XIAO
   #define SDA           4     
@@ -9,7 +15,11 @@
   #define TFT_MOSI      10    // Data out
   #define TFT_SCLK      8     // Clock out
   #define BUTTON_PIN    1
+  #define ADS_RDY_PIN   -1    // ALERT/RDY not wired, conversions are timed
+  #define ADS_DATA_RATE RATE_ADS1115_128SPS
+  #define SAMPLE_FILTER FilterChain<Median<3>, Window<16>>
   #define VAL_MCU       "Seeed Xiao M0"
+  #define FIXED_MATH    1     // no hardware FPU, integer signal path
 
 #elif defined(ARDUINO_XIAO_ESP32C3)  // Seeed XIAO ESP32 C3
   #define SDA           6     
@@ -21,7 +31,11 @@
   #define TFT_RST       4     // Or set to -1 and connect to Arduino RESET pin 
   #define TFT_BL        5
   #define BUTTON_PIN    2
+  #define ADS_RDY_PIN   -1    // ALERT/RDY not wired, conversions are timed
+  #define ADS_DATA_RATE RATE_ADS1115_250SPS
+  #define SAMPLE_FILTER FilterChain<Median<5>, Ema<2>, Window<16>>
   #define VAL_MCU       "Seeed Xiao ESP32 C3"
+  #define FIXED_MATH    1     // no hardware FPU, integer signal path
   #include "bat_stat.h"
   #define BAT_ADJ       3.5
 
@@ -36,6 +50,9 @@
   #define TFT_BL      27  // LED back-light
   #define TOUCH_CS    33     // Chip select pin (T_CS) of touch screen
   #define BUTTON_PIN  -1
+  #define ADS_RDY_PIN -1    // ALERT/RDY not wired, conversions are timed
+  #define ADS_DATA_RATE RATE_ADS1115_475SPS
+  #define SAMPLE_FILTER FilterChain<Median<5>, Ema<3>, Window<24>>
   #define VAL_MCU       "ESP32 Elecrow"
   #include "bat_stat.h"
   #define BAT_ADJ       15.0
@@ -51,6 +68,9 @@
   #define TFT_CS        34
   #define BUTTON_PIN    4
   #define VAL_MCU       "UM Tiny S3 ESP32"
+  #define ADS_RDY_PIN   -1    // ALERT/RDY not wired, conversions are timed
+  #define ADS_DATA_RATE RATE_ADS1115_475SPS
+  #define SAMPLE_FILTER FilterChain<Median<5>, Ema<3>, Window<24>>
   #include "bat_stat.h"
   #define BAT_ADJ       1.9
     
@@ -65,6 +85,10 @@
   #define TFT_BL        3
   #define BUTTON_PIN    9
   #define VAL_MCU       "ESP32-C3-2424S0122"
+  #define FIXED_MATH    1     // no hardware FPU, integer signal path
+  #define ADS_RDY_PIN   -1    // ALERT/RDY not wired, conversions are timed
+  #define ADS_DATA_RATE RATE_ADS1115_250SPS
+  #define SAMPLE_FILTER FilterChain<Median<5>, Ema<2>, Window<16>>
   #include "bat_stat.h"
   #define BAT_ADJ       1.9
 
@@ -87,6 +111,10 @@
   #define TFT_RST       -1   // Or set to -1 and connect to Arduino RESET pin
   #define BUTTON_PIN    9
   #define VAL_MCU       "TTGO T-OI PLUS RISC-V ESP32-C3"
+  #define FIXED_MATH    1     // no hardware FPU, integer signal path
+  #define ADS_RDY_PIN   -1    // ALERT/RDY not wired, conversions are timed
+  #define ADS_DATA_RATE RATE_ADS1115_250SPS
+  #define SAMPLE_FILTER FilterChain<Median<5>, Ema<2>, Window<16>>
   #include "bat_stat.h"
   #define BAT_ADJ       1.0
   
@@ -107,6 +135,9 @@
   #define TFT_BL      27  // LED back-light
   #define TOUCH_CS    33     // Chip select pin (T_CS) of touch screen
   #define BUTTON_PIN  4
+  #define ADS_RDY_PIN -1    // ALERT/RDY not wired, conversions are timed
+  #define ADS_DATA_RATE RATE_ADS1115_475SPS
+  #define SAMPLE_FILTER FilterChain<Median<5>, Ema<3>, Window<24>>
   #include "bat_stat.h"
   #define BAT_ADJ       4.0
 
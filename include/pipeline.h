@@ -0,0 +1,127 @@
+/*
+ *  Reading pipeline
+ *
+ *  Turns a filtered ADC value into everything that is shown for it: % O2, sensor
+ *  mV, the MODs, the STABLE flag and, with fastRead, the predicted final value.
+ *  Holds the calibration and the per-reading state, but no display or hardware,
+ *  so the firmware and the host build run the same code.  FIXED_MATH (see
+ *  pin_config.h) selects the integer path.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "fixed_point.h"
+#include "gas_math.h"
+#include "filter_chain.h"
+#include "stability.h"
+#include "settle_predictor.h"
+
+#ifndef FIXED_MATH
+#define FIXED_MATH 0   // 1= integer / Q16.16 signal path, set per board in pin_config.h
+#endif
+
+// Everything the display needs from one processed sample
+struct Reading
+{
+    float ave;        // filtered ADC counts
+    float mV;
+    float batV;
+    float o2;         // % O2 shown
+    float o2Measured; // % O2 measured, differs from o2 while fastRead predicts
+    int mod14fsw;
+    int mod14msw;
+    int mod16fsw;
+    int mod16msw;
+    bool stable;
+    bool predicting;
+    float band;       // +/- of the fastRead estimate
+    bool adcFault = false; // ADC off the bus: the values are stale, not a reading
+};
+
+struct Pipeline
+{
+    float calFactor = 1;   // % O2 per count
+    float multiplier = 0;  // mV per count
+    float modppo = 1.4;
+    float mod16ppo = 1.6;
+#if FIXED_MATH == 1
+    q24_t calFactorQ = Q24_ONE; // calFactor in Q8.24
+    q24_t multiplierQ = 0;
+    q16_t modppoQ = q16(1.4);
+    q16_t mod16ppoQ = q16(1.6);
+#endif
+    bool fastRead = false; // show the predicted final O2 while the cell settles
+    StabilityDetector stability;
+    SettlePredictor predictor;
+};
+
+// Calibrate from the mean of an air read, sum / count counts
+inline void pipelineCalibrate(Pipeline &p, int32_t sum, uint16_t count)
+{
+    p.calFactor = calFactorFor((float)sum / count); // Auto Calibrate to 20.9%
+#if FIXED_MATH == 1
+    p.calFactorQ = calFactorQ24(sum, count);
+#endif
+}
+
+inline void pipelineSetMultiplier(Pipeline &p, float mvPerCount)
+{
+    p.multiplier = mvPerCount;
+#if FIXED_MATH == 1
+    p.multiplierQ = q24(mvPerCount);
+#endif
+}
+
+// Process one filtered value (counts scaled by 2^FILTER_FRAC).  Returns true when
+// the reading has just become stable.
+inline bool pipelineProcess(Pipeline &p, int32_t filtered, float batV, uint32_t nowMs, Reading &rd)
+{
+#if FIXED_MATH == 1
+    // Integer path, float only for display and debug output
+    q16_t aveQ = filtered * (1 << (16 - FILTER_FRAC));
+    q16_t o2Q = o2FromCountsQ16(aveQ, p.calFactorQ);
+    rd.ave = q16ToFloat(aveQ);
+    rd.o2 = q16ToFloat(o2Q);                           // Units: pct
+    rd.mV = q16ToFloat(q16MulQ24(aveQ, p.multiplierQ)); // Units: mV
+#else
+    rd.ave = filterToFloat(filtered);
+    rd.o2 = o2FromCounts(rd.ave, p.calFactor); // Units: pct
+    rd.mV = (rd.ave * p.multiplier);           // Units: mV
+#endif
+    rd.batV = batV;
+
+    bool settled = stabAdd(p.stability, nowMs, rd.o2) && p.stability.state == STAB_STABLE;
+    rd.stable = (p.stability.state == STAB_STABLE);
+
+    rd.o2Measured = rd.o2;
+    rd.predicting = false;
+    rd.band = 0;
+    if (p.fastRead)
+    {
+        // Show where the cell is heading until the measured value catches up
+        rd.predicting = (predAdd(p.predictor, nowMs, rd.o2Measured) == PRED_PREDICTING);
+        if (rd.predicting)
+        {
+            float pred = p.predictor.predicted;
+            rd.o2 = (pred < 0) ? 0 : (pred > O2_MAX) ? O2_MAX : pred;
+            rd.band = p.predictor.band;
+#if FIXED_MATH == 1
+            o2Q = q16FromFloat(rd.o2);
+#endif
+        }
+    }
+
+#if FIXED_MATH == 1
+    rd.mod14fsw = modDepthQ16(o2Q, p.modppoQ, 33);
+    rd.mod14msw = modDepthQ16(o2Q, p.modppoQ, 10);
+    rd.mod16fsw = modDepthQ16(o2Q, p.mod16ppoQ, 33);
+    rd.mod16msw = modDepthQ16(o2Q, p.mod16ppoQ, 10);
+#else
+    rd.mod14fsw = modDepth(rd.o2, p.modppo, 33);
+    rd.mod14msw = modDepth(rd.o2, p.modppo, 10);
+    rd.mod16fsw = modDepth(rd.o2, p.mod16ppo, 33);
+    rd.mod16msw = modDepth(rd.o2, p.mod16ppo, 10);
+#endif
+    return settled;
+}
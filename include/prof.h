@@ -0,0 +1,85 @@
+/*
+ *  Per-stage profile histograms
+ *
+ *  Each stage keeps a count, min, mean and max and a power-of-two histogram of
+ *  its durations: bucket k holds the runs that took 2^k to 2^(k+1)-1 ticks.  The
+ *  ticks are whatever the caller measures with, CPU cycles on the ESP32 boards.
+ *  The firmware wraps its stages in the profStart()/profStop() macros, which
+ *  compile to nothing when DEBUG is 0 (see main.cpp).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define PROF_BUCKETS 24 // up to 2^24 ticks, longer runs land in the last bucket
+
+struct ProfStage
+{
+    const char *name;
+    uint32_t n = 0;
+    uint64_t sum = 0;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint32_t hist[PROF_BUCKETS] = {0};
+
+    ProfStage(const char *name) : name(name) {}
+};
+
+inline uint8_t profBucket(uint32_t ticks)
+{
+    uint8_t k = 0;
+    while (ticks > 1 && k < PROF_BUCKETS - 1)
+    {
+        ticks >>= 1;
+        k++;
+    }
+    return k;
+}
+
+inline void profAdd(ProfStage &s, uint32_t ticks)
+{
+    s.n++;
+    s.sum += ticks;
+    s.min = (ticks < s.min) ? ticks : s.min;
+    s.max = (ticks > s.max) ? ticks : s.max;
+    s.hist[profBucket(ticks)]++;
+}
+
+inline void profReset(ProfStage &s)
+{
+    s.n = 0;
+    s.sum = 0;
+    s.min = UINT32_MAX;
+    s.max = 0;
+    for (uint8_t k = 0; k < PROF_BUCKETS; k++)
+    {
+        s.hist[k] = 0;
+    }
+}
+
+// One line per stage, "name n min mean max" then the non-empty buckets as
+// lower-bound:count, written through out()
+inline void profDump(ProfStage *const *stages, uint8_t count, const char *unit, void (*out)(const char *s))
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "prof stage n min mean max (%s) | bucket:count\n", unit);
+    out(buf);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const ProfStage &s = *stages[i];
+        snprintf(buf, sizeof(buf), "prof %-8s %lu %lu %lu %lu |", s.name, (unsigned long)s.n,
+                 (unsigned long)(s.n ? s.min : 0), (unsigned long)(s.n ? s.sum / s.n : 0), (unsigned long)s.max);
+        out(buf);
+        for (uint8_t k = 0; k < PROF_BUCKETS; k++)
+        {
+            if (s.hist[k])
+            {
+                snprintf(buf, sizeof(buf), " %lu:%lu", (unsigned long)(1UL << k), (unsigned long)s.hist[k]);
+                out(buf);
+            }
+        }
+        out("\n");
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ *  Statically sized ring buffer with an integer running sum
+ *
+ *  RingBuffer<int16_t, 20> holds the last 20 raw ADS1115 counts.  The buffer is a
+ *  member array, so a global instance lands in .bss with no heap allocation, and
+ *  the sum is kept exact in int32 so the average is O(1) and free of float drift.
+ *  Method names follow RunningAverage, which it replaces.
+ *
+ *  The reading path no longer holds raw counts: the filter chain's Window is a
+ *  RingBuffer<int32_t, N> of counts scaled by 2^FILTER_FRAC, since it averages
+ *  the EMA output and int16 would throw its sub-count resolution away.  That
+ *  costs 2 bytes a slot (40 for the 20 slot window), still in .bss.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "fixed_point.h"
+
+template <typename T, uint8_t N>
+class RingBuffer
+{
+    static_assert(N >= 1, "RingBuffer needs at least one slot");
+    static_assert(sizeof(T) <= sizeof(int32_t), "RingBuffer sums into int32");
+
+public:
+    void clear()
+    {
+        _sum = 0;
+        _idx = 0;
+        _cnt = 0;
+    }
+
+    // Add a value, dropping the oldest once full
+    void addValue(T v)
+    {
+        if (_cnt == N)
+        {
+            _sum -= _buf[_idx];
+        }
+        else
+        {
+            _cnt++;
+        }
+        _buf[_idx] = v;
+        _sum += v;
+        _idx = (_idx + 1 == N) ? 0 : _idx + 1;
+    }
+
+    // Truncating integer average
+    int32_t average() const { return _cnt ? _sum / _cnt : 0; }
+
+    q16_t averageQ16() const
+    {
+        return _cnt ? (q16_t)(((int64_t)_sum << 16) / _cnt) : 0;
+    }
+
+    float getAverage() const { return _cnt ? (float)_sum / _cnt : 0; }
+    int32_t getSum() const { return _sum; }
+    uint8_t getCount() const { return _cnt; }
+    uint8_t getSize() const { return N; }
+    bool isFull() const { return _cnt == N; }
+
+    // i = 0 is the oldest value held
+    T getValue(uint8_t i) const
+    {
+        uint16_t pos = (_cnt == N) ? _idx + i : i;
+        return _buf[pos % N];
+    }
+
+private:
+    T _buf[N];
+    int32_t _sum = 0;
+    uint8_t _idx = 0;
+    uint8_t _cnt = 0;
+};
@@ -0,0 +1,210 @@
+/*
+ *  Continuous-conversion sampler for the ADS1115
+ *
+ *  The ADC free-runs at ADS_DATA_RATE and pulses ALERT/RDY at the end of every
+ *  conversion.  The ISR only counts the pulse and wakes the reader; the I2C read
+ *  of the conversion register happens in samplerPoll(), outside interrupt context,
+ *  and the result is queued in a small FIFO.  Boards without ALERT/RDY wired
+ *  (ADS_RDY_PIN -1) time the conversions from the data rate instead and sleep
+ *  in whole ticks, so each conversion is read up to a millisecond late.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "ads_session.h"
+
+#ifndef ADS_RDY_PIN
+#define ADS_RDY_PIN    -1
+#endif
+
+#define SAMPLER_FIFO   32   // queued conversions, power of two
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR           // only ESP32 needs ISRs placed in IRAM
+#endif
+
+struct Sampler
+{
+    AdsSession *ads = nullptr;
+    uint32_t periodUs = 0;   // conversion period at the session's data rate
+    uint32_t lastUs = 0;     // time of the last timed conversion (no RDY pin)
+    uint32_t readyUs = 0;    // when the newest queued conversion was ready
+    uint32_t seen = 0;       // RDY pulses already accounted for
+    int16_t fifo[SAMPLER_FIFO];
+    uint8_t head = 0;
+    uint8_t tail = 0;
+    uint32_t count = 0;      // conversions read
+    uint32_t missed = 0;     // conversions overwritten before they were read
+    uint32_t overruns = 0;   // conversions dropped because the FIFO was full
+};
+
+volatile uint32_t samplerReady = 0;   // ALERT/RDY pulses seen by the ISR
+volatile uint32_t samplerReadyUs = 0; // micros() of the last pulse
+
+#if defined(ESP32)
+SemaphoreHandle_t samplerSignal = nullptr;
+#endif
+
+void IRAM_ATTR samplerISR()
+{
+    samplerReadyUs = micros();
+    samplerReady++;
+#if defined(ESP32)
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(samplerSignal, &woken);
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+#endif
+}
+
+// Put the ADC in continuous mode and arm the conversion-ready interrupt
+void samplerStart(Sampler &s, AdsSession &ads)
+{
+    s.ads = &ads;
+    s.periodUs = 1000000UL / adsRateSps(ads.dataRate);
+    ads.continuous = true;
+    adsConfigure(ads);
+    s.lastUs = micros();
+
+#if ADS_RDY_PIN >= 0
+#if defined(ESP32)
+    if (samplerSignal == nullptr)
+    {
+        samplerSignal = xSemaphoreCreateBinary();
+    }
+#endif
+    pinMode(ADS_RDY_PIN, INPUT_PULLUP); // ALERT/RDY is open drain, active low
+    s.seen = samplerReady;
+    attachInterrupt(digitalPinToInterrupt(ADS_RDY_PIN), samplerISR, FALLING);
+#endif
+}
+
+void samplerPush(Sampler &s, int16_t v)
+{
+    uint8_t next = (s.head + 1) & (SAMPLER_FIFO - 1);
+    if (next == s.tail)
+    {
+        s.overruns++;
+        s.tail = (s.tail + 1) & (SAMPLER_FIFO - 1); // keep the newest
+    }
+    s.fifo[s.head] = v;
+    s.head = next;
+}
+
+bool samplerTake(Sampler &s, int16_t &v)
+{
+    if (s.tail == s.head)
+    {
+        return false;
+    }
+    v = s.fifo[s.tail];
+    s.tail = (s.tail + 1) & (SAMPLER_FIFO - 1);
+    return true;
+}
+
+// Read the conversion register if a new result is due.  force reads it anyway,
+// which also keeps the session's reconnect logic running while the ADC is down.
+// Returns true when a sample was queued.
+bool samplerPoll(Sampler &s, bool force = false)
+{
+    bool due = force;
+
+#if ADS_RDY_PIN >= 0
+    uint32_t ready = samplerReady;
+    if (ready != s.seen)
+    {
+        s.missed += ready - s.seen - 1; // the register only holds the latest result
+        s.seen = ready;
+        s.readyUs = samplerReadyUs;
+        due = true;
+    }
+#else
+    uint32_t now = micros();
+    uint32_t late = now - s.lastUs;
+    if (late >= s.periodUs)
+    {
+        s.missed += (late / s.periodUs) - 1;
+        s.lastUs = now - (late % s.periodUs);
+        s.readyUs = s.lastUs;
+        due = true;
+    }
+#endif
+
+    if (!due)
+    {
+        return false;
+    }
+
+    int16_t raw = 0;
+    if (s.ads->state != ADS_DOWN)
+    {
+        raw = s.ads->adc->getLastConversionResults();
+    }
+    samplerPush(s, adsCheck(*s.ads, raw));
+    s.count++;
+    return true;
+}
+
+// Sleep until the next conversion should be ready.  Returns false on timeout.
+bool samplerWait(Sampler &s)
+{
+#if ADS_RDY_PIN >= 0 && defined(ESP32)
+    return (xSemaphoreTake(samplerSignal, pdMS_TO_TICKS(2 + (2 * s.periodUs) / 1000)) == pdTRUE);
+#elif ADS_RDY_PIN >= 0
+    uint32_t start = micros();
+    while (samplerReady == s.seen)
+    {
+        if ((micros() - start) > (2 * s.periodUs))
+        {
+            return false;
+        }
+        yield();
+    }
+    return true;
+#elif defined(ARDUINO_ARCH_SAMD)
+    while ((micros() - s.lastUs) < s.periodUs)
+    {
+        __WFI(); // woken by the 1 ms SysTick, at most a tick late
+    }
+    return true;
+#else
+    uint32_t elapsed = micros() - s.lastUs;
+    if (elapsed < s.periodUs)
+    {
+        // Whole ticks, rounded up: the conversion is read up to a tick late (it
+        // stays in the register for a period) rather than spinning for the rest
+        delay((s.periodUs - elapsed + 999) / 1000);
+    }
+    return true;
+#endif
+}
+
+// Oldest queued conversion, waiting for one if the FIFO is empty
+int16_t samplerNext(Sampler &s)
+{
+    int16_t v;
+    samplerPoll(s);
+    while (!samplerTake(s, v))
+    {
+        samplerPoll(s, !samplerWait(s));
+    }
+    return v;
+}
+
+// Newest conversion, discarding anything older that is still queued
+int16_t samplerLatest(Sampler &s)
+{
+    int16_t v;
+    samplerPoll(s);
+    if (!samplerTake(s, v))
+    {
+        return samplerNext(s);
+    }
+    while (samplerTake(s, v))
+    {
+    }
+    return v;
+}
@@ -0,0 +1,110 @@
+/*
+ *  Cooperative multi-rate scheduler
+ *
+ *  Named periodic jobs on a millisecond tick.  A job is released every periodMs
+ *  and must finish within deadlineMs of its release, otherwise an overrun is
+ *  counted; a job released so late that whole periods went by skips them (one
+ *  overrun) rather than running back to back to catch up.  Jobs never preempt each
+ *  other, so each must return quickly.  Jobs are in priority order: schedRun()
+ *  runs the first one that is due and returns how long the caller may sleep.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define SCHED_MAX_JOBS 8
+
+typedef void (*JobFn)();
+
+struct SchedJob
+{
+    const char *name;
+    JobFn fn;
+    uint32_t periodMs;
+    uint32_t deadlineMs;  // from release to finish
+    uint32_t releaseMs;   // next release
+    uint32_t runs;
+    uint32_t overruns;
+    uint32_t maxUs;       // longest run
+};
+
+struct Scheduler
+{
+    SchedJob jobs[SCHED_MAX_JOBS];
+    uint8_t count = 0;
+    uint32_t (*clockUs)() = nullptr; // times each run
+};
+
+// Add a job, first release now.  Returns false when the table is full.
+inline bool schedAdd(Scheduler &s, const char *name, JobFn fn, uint32_t periodMs, uint32_t deadlineMs, uint32_t nowMs)
+{
+    if (s.count >= SCHED_MAX_JOBS || periodMs == 0)
+    {
+        return false;
+    }
+    SchedJob &j = s.jobs[s.count++];
+    j.name = name;
+    j.fn = fn;
+    j.periodMs = periodMs;
+    j.deadlineMs = deadlineMs;
+    j.releaseMs = nowMs;
+    j.runs = 0;
+    j.overruns = 0;
+    j.maxUs = 0;
+    return true;
+}
+
+// Run the highest priority job that is due.  Returns the ms until the next
+// release, 0 when another job is already due.
+inline uint32_t schedRun(Scheduler &s, uint32_t nowMs)
+{
+    for (uint8_t i = 0; i < s.count; i++)
+    {
+        SchedJob &j = s.jobs[i];
+        if ((int32_t)(nowMs - j.releaseMs) < 0)
+        {
+            continue;
+        }
+
+        uint32_t start = s.clockUs();
+        j.fn();
+        uint32_t us = s.clockUs() - start;
+        uint32_t doneMs = nowMs + us / 1000;
+
+        j.runs++;
+        if (us > j.maxUs)
+        {
+            j.maxUs = us;
+        }
+        bool late = (doneMs - j.releaseMs) > j.deadlineMs;
+
+        j.releaseMs += j.periodMs;
+        if ((int32_t)(doneMs - j.releaseMs) >= 0)
+        {
+            j.releaseMs += ((doneMs - j.releaseMs) / j.periodMs + 1) * j.periodMs; // skip missed periods
+            late = true;
+        }
+        if (late)
+        {
+            j.overruns++;
+        }
+        nowMs = doneMs;
+        break;
+    }
+
+    uint32_t wait = UINT32_MAX;
+    for (uint8_t i = 0; i < s.count; i++)
+    {
+        int32_t until = (int32_t)(s.jobs[i].releaseMs - nowMs);
+        if (until <= 0)
+        {
+            return 0;
+        }
+        if ((uint32_t)until < wait)
+        {
+            wait = until;
+        }
+    }
+    return (s.count ? wait : 0);
+}
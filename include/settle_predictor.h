@@ -0,0 +1,137 @@
+/*
+ *  Predictive settling for galvanic O2 cells
+ *
+ *  A galvanic cell answers a gas change as a first-order lag, so readings taken at
+ *  a fixed interval dt follow y[k+L] - y[k] = (1 - a^L) * (A - y[k]), with A the
+ *  final value and a = exp(-dt / tau).  Regressing the change d = y[k+L] - y[k]
+ *  against y[k] over a short window gives a straight line whose zero crossing is
+ *  A, the reading the cell is heading for.  The lag L lifts the change above the
+ *  sample noise.  The standard error of that crossing gives the uncertainty band;
+ *  it takes the points as independent, which the filter ahead of it makes them
+ *  not quite, so the band runs a little narrow.  Once the measured value is
+ *  within PRED_SETTLE_PCT of the asymptote the predictor reports SETTLED and the
+ *  measured value is shown.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "trend_stats.h"
+
+#define PRED_DT_MS       100   // decimation interval of the fitted points
+#define PRED_POINTS      30    // window of fitted points (3 s)
+#define PRED_LAG         5     // points between the pairs that are differenced
+#define PRED_MIN_POINTS  (PRED_LAG + 5) // points needed before a prediction is made
+#define PRED_SETTLE_PCT  0.1   // % O2, measured is this close to final: settled
+#define PRED_MAX_BAND    2.0   // % O2, a wider 95% band is not worth showing
+
+enum PredState
+{
+    PRED_SETTLED,     // measured value is final, show it
+    PRED_TRACKING,    // moving, but no trustworthy prediction yet
+    PRED_PREDICTING   // moving, predicted final value available
+};
+
+struct SettlePredictor
+{
+    float pts[PRED_POINTS];
+    uint8_t idx = 0;
+    uint8_t cnt = 0;
+    uint32_t lastMs = 0;
+    PredState state = PRED_SETTLED;
+    float predicted = 0;   // asymptote of the first-order fit
+    float band = 0;        // 95% half-width of predicted
+    float tau = 0;         // fitted time constant, seconds
+};
+
+inline void predReset(SettlePredictor &p)
+{
+    p = SettlePredictor();
+}
+
+inline float predPoint(const SettlePredictor &p, uint8_t i) // 0 = oldest
+{
+    return p.pts[(p.cnt == PRED_POINTS ? p.idx + i : i) % PRED_POINTS];
+}
+
+// Refit from the window of decimated points
+inline void predFit(SettlePredictor &p)
+{
+    float newest = predPoint(p, p.cnt - 1);
+    p.state = PRED_TRACKING;
+
+    if (fabsf(newest - predPoint(p, 0)) < PRED_SETTLE_PCT)
+    {
+        p.state = PRED_SETTLED;
+        return;
+    }
+    if (p.cnt < PRED_MIN_POINTS)
+    {
+        return;
+    }
+
+    TrendStats s; // x = y[k], y = y[k+L] - y[k]
+    for (uint8_t i = 0; i + PRED_LAG < p.cnt; i++)
+    {
+        float y = predPoint(p, i);
+        trendAdd(s, y, predPoint(p, i + PRED_LAG) - y);
+    }
+
+    float m = trendSlope(s); // -(1 - a^L)
+    if (!(m < -0.005f && m > -0.95f))
+    {
+        return; // not a converging first-order response (yet)
+    }
+
+    float aL = 1 + m;
+    float x0 = s.meanT - s.meanY / m;
+    float resid = (s.m2Y - (s.cTY * s.cTY) / s.m2T) / (s.n - 2);
+    float dx = x0 - s.meanT;
+    float se = sqrtf(resid > 0 ? resid : 0) / -m * sqrtf(1.0f / s.n + (dx * dx) / s.m2T);
+
+    p.predicted = x0;
+    p.band = 1.96f * se;
+    p.tau = -(PRED_LAG * PRED_DT_MS / 1000.0f) / logf(aL);
+
+    if (fabsf(x0 - newest) < PRED_SETTLE_PCT)
+    {
+        p.state = PRED_SETTLED;
+    }
+    else if (p.band < PRED_MAX_BAND)
+    {
+        p.state = PRED_PREDICTING;
+    }
+}
+
+// Feed every published reading; points are taken every PRED_DT_MS
+inline PredState predAdd(SettlePredictor &p, uint32_t nowMs, float value)
+{
+    if (p.cnt && (nowMs - p.lastMs) < PRED_DT_MS)
+    {
+        return p.state;
+    }
+    p.lastMs = nowMs;
+
+    // A new step after a settled reading: fit from the last settled point on, so
+    // the flat run before the step does not bend the line
+    if (p.state == PRED_SETTLED && p.cnt > 1)
+    {
+        float last = predPoint(p, p.cnt - 1);
+        if (fabsf(value - last) >= PRED_SETTLE_PCT)
+        {
+            p.pts[0] = last;
+            p.idx = 1;
+            p.cnt = 1;
+        }
+    }
+
+    p.pts[p.idx] = value;
+    p.idx = (p.idx + 1) % PRED_POINTS;
+    if (p.cnt < PRED_POINTS)
+    {
+        p.cnt++;
+    }
+    predFit(p);
+    return p.state;
+}
@@ -0,0 +1,75 @@
+/*
+ *  Lock-free single-producer / single-consumer ring
+ *
+ *  One task pushes, one task pops; the head is only written by the producer and
+ *  the tail only by the consumer, so acquire/release ordering on those two indices
+ *  is all the synchronisation needed.  No locks, no heap, safe to push from a task
+ *  that must never block.  When full, push() fails and counts the drop rather than
+ *  waiting.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, uint16_t N>
+class SpscQueue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    // Producer side
+    bool push(const T &v)
+    {
+        uint16_t head = _head.load(std::memory_order_relaxed);
+        uint16_t next = (head + 1) & (N - 1);
+        if (next == _tail.load(std::memory_order_acquire))
+        {
+            // Only the producer writes it: a load and a store, no read-modify-write,
+            // which the Cortex-M0+ has no instruction for (and no libatomic)
+            _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        _buf[head] = v;
+        _head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T &v)
+    {
+        uint16_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        v = _buf[tail];
+        _tail.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: pop everything, keep only the newest
+    bool latest(T &v)
+    {
+        bool any = false;
+        while (pop(v))
+        {
+            any = true;
+        }
+        return any;
+    }
+
+    bool empty() const
+    {
+        return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+    }
+
+    uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    T _buf[N];
+    std::atomic<uint16_t> _head{0};
+    std::atomic<uint16_t> _tail{0};
+    std::atomic<uint32_t> _dropped{0}; // producer owned
+};
@@ -0,0 +1,113 @@
+/*
+ *  Stability detector
+ *
+ *  Flags a reading as STABLE once the slope and the spread of the O2 value over
+ *  the last STABLE_WINDOW_MS are both inside their limits.  A move of more than
+ *  STABLE_STEP_PCT away from the last stable value starts a new analysis (the next
+ *  cylinder), and the time from that move to STABLE is recorded so the latency can
+ *  be compared across sensors.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "trend_stats.h"
+
+#ifndef STABLE_WINDOW_MS
+#define STABLE_WINDOW_MS   2000  // window the slope and spread are taken over
+#endif
+#define STABLE_DT_MS       100   // spacing of the points in the window
+#define STABLE_POINTS      (STABLE_WINDOW_MS / STABLE_DT_MS)
+#define STABLE_SLOPE_PCT   0.03  // % O2 per second
+#define STABLE_SD_PCT      0.05  // % O2 standard deviation
+#define STABLE_STEP_PCT    0.3   // % O2 move that starts a new analysis
+
+enum StabState
+{
+    STAB_UNSTABLE,
+    STAB_STABLE
+};
+
+struct StabilityDetector
+{
+    float pts[STABLE_POINTS];
+    uint8_t idx = 0;
+    uint8_t cnt = 0;
+    uint32_t lastMs = 0;
+    StabState state = STAB_UNSTABLE;
+    float slope = 0;          // % O2 per second over the window
+    float sd = 0;             // % O2 over the window
+    float stableValue = 0;    // value when STABLE was last reached
+    uint32_t startMs = 0;     // start of the current analysis
+    uint32_t lastTimeMs = 0;  // time to stability of the last analysis
+    uint32_t maxTimeMs = 0;
+    uint32_t sumTimeMs = 0;
+    uint16_t analyses = 0;    // analyses that reached STABLE
+};
+
+// Mean time to stability over all analyses
+inline uint32_t stabMeanTime(const StabilityDetector &d)
+{
+    return d.analyses ? d.sumTimeMs / d.analyses : 0;
+}
+
+// Feed every published reading.  Returns true when the state changed.
+inline bool stabAdd(StabilityDetector &d, uint32_t nowMs, float value)
+{
+    if (d.cnt && (nowMs - d.lastMs) < STABLE_DT_MS)
+    {
+        return false;
+    }
+    // Points on a STABLE_DT_MS grid, as the slope takes them, not every frame
+    // that happens to come after one: at 33 ms frames that would be every 132 ms
+    d.lastMs = (d.cnt && (nowMs - d.lastMs) < 2 * STABLE_DT_MS) ? d.lastMs + STABLE_DT_MS : nowMs;
+    if (d.cnt == 0)
+    {
+        d.startMs = nowMs;
+    }
+
+    d.pts[d.idx] = value;
+    d.idx = (d.idx + 1) % STABLE_POINTS;
+    if (d.cnt < STABLE_POINTS)
+    {
+        d.cnt++;
+        return false;
+    }
+
+    TrendStats s;
+    for (uint8_t i = 0; i < STABLE_POINTS; i++)
+    {
+        uint8_t k = (d.idx + i) % STABLE_POINTS; // oldest first
+        trendAdd(s, i * (STABLE_DT_MS / 1000.0f), d.pts[k]);
+    }
+    d.slope = trendSlope(s);
+    d.sd = sqrtf(trendVariance(s));
+
+    // A change of gas, or a reading that starts moving again, starts a new analysis
+    if (d.state == STAB_STABLE)
+    {
+        if (fabsf(value - d.stableValue) > STABLE_STEP_PCT || fabsf(d.slope) > 2 * STABLE_SLOPE_PCT)
+        {
+            d.state = STAB_UNSTABLE;
+            d.startMs = nowMs;
+            return true;
+        }
+        return false;
+    }
+
+    if (fabsf(d.slope) < STABLE_SLOPE_PCT && d.sd < STABLE_SD_PCT)
+    {
+        d.state = STAB_STABLE;
+        d.stableValue = s.meanY;
+        d.lastTimeMs = nowMs - d.startMs;
+        if (d.lastTimeMs > d.maxTimeMs)
+        {
+            d.maxTimeMs = d.lastTimeMs;
+        }
+        d.sumTimeMs += d.lastTimeMs;
+        d.analyses++;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,206 @@
+/*
+ *  Telemetry record
+ *
+ *  One record per published reading, handed from the render side to the telemetry
+ *  side so the debug output never holds up measurement or drawing.
+ *
+ *  On the wire (TELEMETRY 2) a record is packed into TLM_PAYLOAD little-endian
+ *  bytes of fixed-point fields, followed by its crc16, COBS encoded and put
+ *  between two 0x00 delimiters:
+ *
+ *    00  COBS( version msgid ms raw adc*16 uV mV_bat o2*100 o2meas*100 mod14 mod16 flags  crc16 )  00
+ *
+ *  35 bytes a record against about 100 of tab separated text.  The leading
+ *  delimiter keeps debug text printed between frames out of the next frame, so
+ *  the decoder only loses the text.  To log: stty -F /dev/ttyUSB0 921600 raw;
+ *  cat /dev/ttyUSB0 > log.bin, then program -D log.bin on the native build.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "crc16.h"
+
+#define TLM_VERSION   1
+#define TLM_PAYLOAD   30                  // packed record
+#define TLM_FRAME_MAX (TLM_PAYLOAD + 2 + 1 + 2) // + crc, COBS code byte, delimiters
+
+struct TelemetryRecord
+{
+    uint32_t msgid;
+    uint32_t ms;         // millis() when the reading was published
+    int16_t raw;         // newest raw ADC counts
+    float adc;           // filtered ADC counts
+    float mV;            // sensor mV
+    float batV;          // battery V
+    float o2;            // % O2 shown
+    float o2Measured;    // % O2 measured, differs from o2 while FASTREAD predicts
+    int16_t mod14;       // MOD @1.4 in fsw
+    int16_t mod16;       // MOD @1.6 in fsw
+    uint8_t stable;      // 1 = STABLE
+};
+
+inline int32_t tlmScale(float v, float scale)
+{
+    v *= scale;
+    return (int32_t)(v >= 0 ? v + 0.5f : v - 0.5f);
+}
+
+inline void tlmPut16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+inline void tlmPut32(uint8_t *p, uint32_t v)
+{
+    tlmPut16(p, v);
+    tlmPut16(p + 2, v >> 16);
+}
+
+inline uint16_t tlmGet16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+inline uint32_t tlmGet32(const uint8_t *p)
+{
+    return tlmGet16(p) | ((uint32_t)tlmGet16(p + 2) << 16);
+}
+
+inline void telemetryPack(const TelemetryRecord &r, uint8_t *p)
+{
+    p[0] = TLM_VERSION;
+    tlmPut32(p + 1, r.msgid);
+    tlmPut32(p + 5, r.ms);
+    tlmPut16(p + 9, r.raw);
+    tlmPut32(p + 11, tlmScale(r.adc, 16));
+    tlmPut32(p + 15, tlmScale(r.mV, 1000));
+    tlmPut16(p + 19, tlmScale(r.batV, 1000));
+    tlmPut16(p + 21, tlmScale(r.o2, 100));
+    tlmPut16(p + 23, tlmScale(r.o2Measured, 100));
+    tlmPut16(p + 25, r.mod14);
+    tlmPut16(p + 27, r.mod16);
+    p[29] = r.stable ? 1 : 0;
+}
+
+inline bool telemetryUnpack(const uint8_t *p, uint8_t n, TelemetryRecord &r)
+{
+    if (n != TLM_PAYLOAD || p[0] != TLM_VERSION)
+    {
+        return false;
+    }
+    r.msgid = tlmGet32(p + 1);
+    r.ms = tlmGet32(p + 5);
+    r.raw = (int16_t)tlmGet16(p + 9);
+    r.adc = (int32_t)tlmGet32(p + 11) / 16.0f;
+    r.mV = (int32_t)tlmGet32(p + 15) / 1000.0f;
+    r.batV = tlmGet16(p + 19) / 1000.0f;
+    r.o2 = tlmGet16(p + 21) / 100.0f;
+    r.o2Measured = tlmGet16(p + 23) / 100.0f;
+    r.mod14 = (int16_t)tlmGet16(p + 25);
+    r.mod16 = (int16_t)tlmGet16(p + 27);
+    r.stable = p[29] & 1;
+    return true;
+}
+
+// COBS, for blocks under 254 bytes: every zero becomes the distance to the next
+inline uint8_t cobsEncode(const uint8_t *in, uint8_t n, uint8_t *out)
+{
+    uint8_t code = 1;
+    uint8_t at = 0; // where the current code byte goes
+    uint8_t o = 1;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        if (in[i] == 0)
+        {
+            out[at] = code;
+            at = o++;
+            code = 1;
+        }
+        else
+        {
+            out[o++] = in[i];
+            code++;
+        }
+    }
+    out[at] = code;
+    return o;
+}
+
+// Returns the decoded length, -1 if the block is not valid COBS
+inline int cobsDecode(const uint8_t *in, uint8_t n, uint8_t *out)
+{
+    uint8_t i = 0;
+    uint8_t o = 0;
+    while (i < n)
+    {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > n)
+        {
+            return -1;
+        }
+        for (uint8_t k = 1; k < code; k++)
+        {
+            out[o++] = in[i++];
+        }
+        if (code < 0xFF && i < n)
+        {
+            out[o++] = 0;
+        }
+    }
+    return o;
+}
+
+// Whole frame, delimiters included.  Returns its length, at most TLM_FRAME_MAX.
+inline uint8_t telemetryFrame(const TelemetryRecord &r, uint8_t *out)
+{
+    uint8_t p[TLM_PAYLOAD + 2];
+    telemetryPack(r, p);
+    uint16_t crc = crc16(p, TLM_PAYLOAD);
+    tlmPut16(p + TLM_PAYLOAD, crc);
+    out[0] = 0;
+    uint8_t n = 1 + cobsEncode(p, sizeof(p), out + 1);
+    out[n++] = 0;
+    return n;
+}
+
+// Byte at a time decoder for the host tools
+struct TelemetryDecoder
+{
+    uint8_t buf[TLM_FRAME_MAX];
+    uint8_t len = 0;
+    bool overflow = false;
+    uint32_t good = 0;
+    uint32_t bad = 0; // delimited blocks that were not a record: text, damage
+};
+
+// Returns true when b completes a good record, which is then in r
+inline bool telemetryFeed(TelemetryDecoder &d, uint8_t b, TelemetryRecord &r)
+{
+    if (b != 0)
+    {
+        if (d.len < sizeof(d.buf))
+        {
+            d.buf[d.len++] = b;
+        }
+        else
+        {
+            d.overflow = true;
+        }
+        return false;
+    }
+    bool ok = false;
+    if (d.len > 0)
+    {
+        uint8_t p[TLM_FRAME_MAX];
+        int n = d.overflow ? -1 : cobsDecode(d.buf, d.len, p);
+        ok = (n == TLM_PAYLOAD + 2 && crc16(p, TLM_PAYLOAD) == tlmGet16(p + TLM_PAYLOAD) &&
+              telemetryUnpack(p, TLM_PAYLOAD, r));
+        ok ? d.good++ : d.bad++;
+    }
+    d.len = 0;
+    d.overflow = false;
+    return ok;
+}
@@ -0,0 +1,331 @@
+/*
+ *  Text UI
+ *
+ *  The text layout: O2 in the seven segment font with the MODs under it, the
+ *  sensor and battery gauges with the stats for nerds, the STABLE / estimate status
+ *  line, and the fault screens.  Draws on a DisplaySurface, so the panel and the
+ *  host build render the same screens.  The labels, stats and gauges are retained
+ *  widgets (widgets.h) fed from the display model (display_model.h): a frame
+ *  only sends the ones whose shown text, colour or fill changed, most frames
+ *  none of them.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hal/hal.h"
+#include "widgets.h"
+#include "pipeline.h"
+#include "display_model.h"
+
+#define FAULT_MS 30000  // how long a fault screen stays up
+
+// Fault screens stay up for FAULT_MS while sampling carries on
+enum FaultState
+{
+    FAULT_NONE,
+    FAULT_SENSOR,
+    FAULT_BATTERY,
+    FAULT_ADC
+};
+
+struct UiConfig
+{
+    int16_t width = 240;   // layout size, not necessarily the panel's
+    int16_t height = 240;
+    uint8_t resFact = 2;   // 1 = 128x128   2 = 240x240
+    bool showMod = true;   // MOD line
+    bool metricMod = false; // MOD in msw instead of fsw
+    bool showNerds = true; // mV and V as text
+    bool showStats = true; // gauges and version
+    bool showBattery = true; // false without a battery monitor: no gauge, no low battery fault
+    float tbFactor = 0;    // gauge row, 0 = top 0.65 = bottom
+    const char *version = "";
+};
+
+struct TextUi
+{
+    DisplaySurface *d = nullptr;
+    UiConfig cfg;
+    DisplayModel model;    // what is on screen, at its displayed precision
+    bool redraw = false;   // screen was cleared, base layout needed
+    FaultState fault = FAULT_NONE;
+    uint32_t faultUntil = 0;
+
+    // Retained widgets, placed by uiBaseLayout()
+    UiText o2;
+    UiText mod14;
+    UiText mod16;
+    UiText title;          // "O %"
+    UiText titleSub;       // the 2 of O2
+    UiText modLegend;
+    UiText version;
+    UiText nerdMv;
+    UiText nerdBat;
+    UiText status;
+    UiBar batBar;
+    UiBar senseBar;
+};
+
+inline void uiFaultScreen(TextUi &ui, FaultState kind, const char *what, const char *level, float value, uint32_t nowMs)
+{
+    if (ui.fault != FAULT_NONE)
+    {
+        return;
+    }
+    DisplaySurface &d = *ui.d;
+    int16_t w = ui.cfg.width;
+    int16_t h = ui.cfg.height;
+    char v[12];
+    uiFormat(v, sizeof(v), value, 2);
+
+    d.fillScreen(TFT_YELLOW);
+    d.setTextColor(TFT_RED);
+    d.setTextSize(1 * ui.cfg.resFact);
+    d.drawCentreString("Error", w * 0.5, h * 0.1, 4);
+    d.drawCentreString(what, w * 0.5, h * 0.4, 4);
+    d.drawCentreString(level, w * 0.5, h * 0.7, 4);
+    d.setTextSize(1);
+    if (!isnan(value))
+    {
+        d.drawCentreString(v, w * .5, h * 0.8, 4);
+    }
+    ui.fault = kind;
+    ui.faultUntil = nowMs + FAULT_MS;
+}
+
+inline void uiSenseFault(TextUi &ui, float mV, uint32_t nowMs)
+{
+    uiFaultScreen(ui, FAULT_SENSOR, "Sensor mV", "LOW", mV, nowMs);
+}
+
+inline void uiBattFault(TextUi &ui, float batV, uint32_t nowMs)
+{
+    uiFaultScreen(ui, FAULT_BATTERY, "Battery", "Low", batV, nowMs);
+}
+
+// No conversions coming in, the last O2 must not stay up looking valid
+inline void uiAdcFault(TextUi &ui, uint32_t nowMs)
+{
+    uiFaultScreen(ui, FAULT_ADC, "ADC", "Fail", NAN, nowMs);
+}
+
+// True while a fault screen is up.  Clears the screen when it expires.
+inline bool uiFaultActive(TextUi &ui, uint32_t nowMs)
+{
+    if (ui.fault == FAULT_NONE)
+    {
+        return false;
+    }
+    if ((int32_t)(nowMs - ui.faultUntil) < 0)
+    {
+        return true;
+    }
+    // Back to the readings, redraw everything
+    ui.fault = FAULT_NONE;
+    ui.d->fillScreen(TFT_BLACK);
+    dmInvalidate(ui.model);
+    ui.redraw = true;
+    return false;
+}
+
+// Static outlines of the battery and sensor gauges, the bars go inside
+inline void uiBatOutline(DisplaySurface &d, int locX, int locY)
+{
+    d.drawRect(locX, locY, 25, 12, TFT_WHITE);
+    d.drawRect((locX + 25), (locY + 4), 3, 4, TFT_WHITE);
+}
+
+inline void uiSenseOutline(DisplaySurface &d, int locX, int locY)
+{
+    d.drawRect(locX, locY, 25, 12, TFT_WHITE);
+    d.drawRect((locX + 5), (locY - 3), 4, 3, TFT_WHITE);
+    d.drawRect((locX + 16), (locY - 3), 4, 3, TFT_WHITE);
+}
+
+// Place the widgets and draw what never changes, on a cleared screen: at start
+// up and after a fault screen.  Every widget draws afresh on the next frame.
+inline void uiBaseLayout(TextUi &ui)
+{
+    // Draw Layout -- Adjust this layouts to suit you LCD
+    DisplaySurface &d = *ui.d;
+    int16_t w = ui.cfg.width;
+    int16_t h = ui.cfg.height;
+    uint8_t rf = ui.cfg.resFact;
+
+    float row = ui.cfg.showMod ? 0.22 : 0.35;
+    uiTextPlace(ui.o2, w * 0.5, h * row, 7, 1 * rf, true);
+    uiTextPlace(ui.mod14, ui.cfg.metricMod ? w * 0.05 : w * 0, h * 0.75, 2, 1 * rf, false);
+    uiTextPlace(ui.mod16, ui.cfg.metricMod ? w * 0.7 : w * 0.6, h * 0.75, 2, 1 * rf, false);
+    uiTextPlace(ui.title, w * 0.5, h * 0, 4, 1 * rf, true);
+    uiTextPlace(ui.titleSub, w * 0.5, h * 0.1, 4, 1, true);
+    uiTextPlace(ui.modLegend, w * 0.5, h * 0.62, 2, 1 * rf, true);
+    uiTextPlace(ui.version, w * 0.5, h * 0.93, 2, 1, true);
+    uiTextPlace(ui.nerdMv, w * 0.18, h * 0.1, 2, 1, true);
+    uiTextPlace(ui.nerdBat, w * 0.88, h * 0.1, 2, 1, true);
+    uiTextPlace(ui.status, w * 0.5, h * 0.87, 2, 1, true);
+    dmInvalidate(ui.model);
+    d.setTextSize(1);
+    ui.status.minWidth = d.textWidth("est +/-00.0", 2);
+
+    int gaugeY = h * (ui.cfg.tbFactor + 0.02);
+    int batX = w * 0.8;
+    int senseX = w * 0.1;
+    uiBarPlace(ui.batBar, batX + 1, gaugeY + 1, 23, 10, TFT_BLACK);
+    uiBarPlace(ui.senseBar, senseX + 1, gaugeY + 1, 23, 10, TFT_BLACK);
+
+    uiTextDraw(d, ui.title, "O %", TFT_MAGENTA, TFT_BLACK);
+    uiTextDraw(d, ui.titleSub, "2", TFT_MAGENTA, TFT_BLACK);
+    if (ui.cfg.showMod)
+    {
+        uiTextDraw(d, ui.modLegend, "@1.4  MOD  @1.6", TFT_ORANGE, TFT_BLACK);
+    }
+    if (ui.cfg.showStats)
+    {
+        if (ui.cfg.showBattery)
+        {
+            uiBatOutline(d, batX, gaugeY);
+        }
+        uiSenseOutline(d, senseX, gaugeY);
+    }
+}
+
+// Gauges and stats for nerds, each widget drawn only when what it shows changed.
+// The fault checks go by the reading, the rest by the display model.
+inline void uiUtilData(TextUi &ui, const Reading &rd, uint32_t nowMs)
+{
+    DisplaySurface &d = *ui.d;
+    float mV = dmMv(ui.model);
+    float batV = dmBatV(ui.model);
+
+    // Fill with the color that matches the charge state
+    if (ui.cfg.showBattery)
+    {
+        if (batV >= 3.6) { uiBarDraw(d, ui.batBar, 23, TFT_GREEN); }
+        else if (batV >= 3.4) { uiBarDraw(d, ui.batBar, 15, TFT_YELLOW); }
+        else { uiBarDraw(d, ui.batBar, 10, TFT_RED); }
+    }
+
+    if (mV >= 9.0) { uiBarDraw(d, ui.senseBar, 23, TFT_BLUE); }
+    else if (mV >= 8.0) { uiBarDraw(d, ui.senseBar, 23, TFT_GREEN); }
+    else if (mV > 7.5) { uiBarDraw(d, ui.senseBar, 23, TFT_YELLOW); }
+    else { uiBarDraw(d, ui.senseBar, 23, TFT_RED); }
+
+    if (ui.cfg.showBattery && rd.batV < 3.2) { uiBattFault(ui, rd.batV, nowMs); }
+    if (rd.mV < 7.1) { uiSenseFault(ui, rd.mV, nowMs); }
+    if (!ui.cfg.showNerds || ui.fault != FAULT_NONE)
+    {
+        return;
+    }
+
+    // Stats for nerds text
+    uint16_t color = (mV > 9.0) ? TFT_SKYBLUE : (mV > 7.5) ? TFT_YELLOW : TFT_RED;
+    uiNumberDraw(d, ui.nerdMv, mV, 1, " mV", color, TFT_BLACK);
+
+    if (ui.cfg.showBattery)
+    {
+        color = (batV >= 3.6) ? TFT_GREEN : (batV >= 3.4) ? TFT_YELLOW : TFT_RED;
+        uiNumberDraw(d, ui.nerdBat, batV, 1, " V", color, TFT_BLACK);
+    }
+
+    uiTextDraw(d, ui.version, ui.cfg.version, TFT_LIGHTGREY, TFT_BLACK);
+}
+
+// O2 and MODs as shown by the display model
+inline void uiReadingText(TextUi &ui)
+{
+    DisplaySurface &d = *ui.d;
+    const DisplayModel &m = ui.model;
+    float o2 = dmO2(m);
+    char buf[16];
+
+    uint16_t color = TFT_CYAN;
+    if (o2 <= 19.5)
+    {
+        color = TFT_YELLOW;
+    }
+    if (o2 <= 17)
+    {
+        color = TFT_RED;
+    }
+    if (o2 >= 22)
+    {
+        color = TFT_GREEN;
+    }
+    if (m.predicting)
+    {
+        color = TFT_SILVER; // estimate, not yet measured
+    }
+    uiFormat(buf, sizeof(buf), o2, 1);
+    uiTextDraw(d, ui.o2, buf, color, TFT_BLACK);
+
+    if (ui.cfg.showMod)
+    {
+        const char *unit = ui.cfg.metricMod ? "-m" : "-FT";
+        snprintf(buf, sizeof(buf), "%d%s", ui.cfg.metricMod ? m.mod14msw : m.mod14fsw, unit);
+        uiTextDraw(d, ui.mod14, buf, TFT_GREENYELLOW, TFT_BLACK);
+        snprintf(buf, sizeof(buf), "%d%s", ui.cfg.metricMod ? m.mod16msw : m.mod16fsw, unit);
+        uiTextDraw(d, ui.mod16, buf, TFT_GOLD, TFT_BLACK);
+    }
+}
+
+// STABLE flag, or the band of the fast readout estimate, under the MODs
+inline void uiStatusLine(TextUi &ui)
+{
+    const DisplayModel &m = ui.model;
+    char status[16] = "";
+    uint16_t color = TFT_GREEN;
+
+    if (m.stable)
+    {
+        strcpy(status, "STABLE");
+    }
+    if (m.predicting)
+    {
+        strcpy(status, "est +/-");
+        uiFormat(status + 7, sizeof(status) - 7, dmBand(m), 1);
+        color = TFT_SILVER;
+    }
+
+    uiTextDraw(*ui.d, ui.status, status, color, TFT_BLACK);
+}
+
+// One text mode frame.  Nothing is drawn unless a value changes on screen.
+inline void uiRender(TextUi &ui, const Reading &rd, uint32_t nowMs)
+{
+    if (uiFaultActive(ui, nowMs))
+    {
+        return; // fault screen stays up
+    }
+    if (rd.adcFault)
+    {
+        uiAdcFault(ui, nowMs);
+        return;
+    }
+    if (ui.redraw)
+    {
+        uiBaseLayout(ui);
+        ui.redraw = false;
+    }
+    uint8_t changed = dmUpdate(ui.model, rd);
+    if (ui.cfg.showStats)
+    {
+        uiUtilData(ui, rd, nowMs);
+        if (ui.fault != FAULT_NONE)
+        {
+            return;
+        }
+    }
+    if (changed & (DM_O2 | DM_MOD))
+    {
+        uiReadingText(ui);
+    }
+    if (changed & (DM_STABLE | DM_O2 | DM_BAND))
+    {
+        uiStatusLine(ui);
+    }
+}
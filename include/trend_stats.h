@@ -0,0 +1,71 @@
+/*
+ *  Running mean, variance and slope of a timed sample stream
+ *
+ *  Welford's update for the mean and variance, and the matching co-moment update
+ *  for the least-squares slope against time, so nothing has to be buffered and
+ *  one pass stays numerically stable.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+struct TrendStats
+{
+    uint32_t n = 0;
+    float meanT = 0;  // seconds
+    float meanY = 0;
+    float m2T = 0;    // sum of squared deviations of t
+    float m2Y = 0;    // sum of squared deviations of y
+    float cTY = 0;    // co-moment of t and y
+};
+
+inline void trendReset(TrendStats &s)
+{
+    s = TrendStats();
+}
+
+inline void trendAdd(TrendStats &s, float t, float y)
+{
+    s.n++;
+    float dT = t - s.meanT;
+    float dY = y - s.meanY;
+    s.meanT += dT / s.n;
+    s.meanY += dY / s.n;
+    s.m2T += dT * (t - s.meanT);
+    s.m2Y += dY * (y - s.meanY);
+    s.cTY += dT * (y - s.meanY);
+}
+
+inline float trendVariance(const TrendStats &s)
+{
+    return (s.n > 1) ? s.m2Y / (s.n - 1) : 0;
+}
+
+// Standard error of the mean
+inline float trendStdErr(const TrendStats &s)
+{
+    return (s.n > 1) ? sqrtf(trendVariance(s) / s.n) : INFINITY;
+}
+
+// Least-squares slope, y units per second
+inline float trendSlope(const TrendStats &s)
+{
+    return (s.m2T > 0) ? s.cTY / s.m2T : 0;
+}
+
+// Standard error of the slope, from the residuals about the fitted line
+inline float trendSlopeErr(const TrendStats &s)
+{
+    if (s.n < 3 || s.m2T <= 0)
+    {
+        return INFINITY;
+    }
+    float resid = s.m2Y - (s.cTY * s.cTY) / s.m2T;
+    if (resid < 0)
+    {
+        resid = 0;
+    }
+    return sqrtf(resid / (s.n - 2) / s.m2T);
+}
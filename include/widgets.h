@@ -0,0 +1,189 @@
+/*
+ *  Retained widgets
+ *
+ *  Labels, numeric fields and bar gauges that remember what they last put on the
+ *  panel and where.  Drawing one with the same text, colour or fill as last time
+ *  sends nothing; a change redraws only that widget's box, cleared to the wider
+ *  of the old and new text so nothing is left behind.  uiTextInvalidate() and
+ *  uiBarInvalidate() force the next draw, after the screen under them was
+ *  cleared.  A bar's outline is static, the layout draws it once.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hal/hal.h"
+
+#define UI_TEXT_MAX 20 // longest label or field, with the terminator
+#define UI_FORMAT_MAX 99999   // largest magnitude uiFormat() shows
+#define UI_FORMAT_DECIMALS 3
+
+struct UiRect
+{
+    int16_t x, y, w, h;
+};
+
+// A label or numeric field: one string at an anchor, left or centred on it
+struct UiText
+{
+    int16_t x = 0, y = 0;
+    uint8_t font = 2;
+    uint8_t size = 1;
+    bool centre = true;
+    uint16_t minWidth = 0;  // cleared at least this wide, keeps the box steady
+    bool valid = false;     // text, colours and box match the panel
+    char text[UI_TEXT_MAX] = "";
+    uint16_t fg = 0, bg = 0;
+    UiRect box = {0, 0, 0, 0}; // last drawn
+};
+
+// A bar in a static outline: the inner box, filled from the left
+struct UiBar
+{
+    UiRect inner = {0, 0, 0, 0};
+    uint16_t back = TFT_BLACK;
+    bool valid = false;
+    int16_t fillW = 0;
+    uint16_t color = 0;
+};
+
+// Same text as String(v, decimals), without relying on printf float support
+// (the SAMD newlib-nano build has none).  Up to UI_FORMAT_DECIMALS decimals,
+// values past UI_FORMAT_MAX show as UI_FORMAT_MAX: at most 10 characters.
+inline void uiFormat(char *buf, size_t n, float v, uint8_t decimals)
+{
+    decimals = (decimals > UI_FORMAT_DECIMALS) ? UI_FORMAT_DECIMALS : decimals;
+    long scale = 1;
+    for (uint8_t i = 0; i < decimals; i++)
+    {
+        scale *= 10;
+    }
+    v = (v > UI_FORMAT_MAX) ? UI_FORMAT_MAX : (v < -UI_FORMAT_MAX) ? -UI_FORMAT_MAX : v;
+    long t = lroundf(v * scale);
+    const char *sign = (t < 0) ? "-" : "";
+    t = labs(t);
+    unsigned whole = (unsigned)(t / scale);
+    unsigned frac = (unsigned)(t % scale);
+    whole = (whole > UI_FORMAT_MAX) ? UI_FORMAT_MAX : whole; // bounds the output for the compiler
+    frac = (frac > 999) ? 999 : frac;
+    if (decimals)
+    {
+        snprintf(buf, n, "%s%u.%0*u", sign, whole, (int)decimals, frac);
+    }
+    else
+    {
+        snprintf(buf, n, "%s%u", sign, whole);
+    }
+}
+
+inline void uiTextPlace(UiText &t, int16_t x, int16_t y, uint8_t font, uint8_t size, bool centre)
+{
+    t.x = x;
+    t.y = y;
+    t.font = font;
+    t.size = size;
+    t.centre = centre;
+    t.valid = false;
+}
+
+inline void uiTextInvalidate(UiText &t)
+{
+    t.valid = false;
+}
+
+// Draw s if it differs from what is on the panel.  Returns true when drawn.
+inline bool uiTextDraw(DisplaySurface &d, UiText &t, const char *s, uint16_t fg, uint16_t bg)
+{
+    if (t.valid && t.fg == fg && t.bg == bg && strcmp(t.text, s) == 0)
+    {
+        return false;
+    }
+    d.setTextSize(t.size);
+    d.setTextColor(fg, bg);
+    int16_t w = d.textWidth(s, t.font);
+    int16_t pad = (w > t.minWidth) ? w : t.minWidth;
+    if (t.valid && t.box.w > pad)
+    {
+        pad = t.box.w; // wipe the longer text that was there
+    }
+    d.setTextPadding(pad);
+    if (t.centre)
+    {
+        d.drawCentreString(s, t.x, t.y, t.font);
+    }
+    else
+    {
+        d.drawString(s, t.x, t.y, t.font);
+    }
+    d.setTextPadding(0);
+
+    w = (w > t.minWidth) ? w : t.minWidth;
+    t.box.x = t.centre ? t.x - w / 2 : t.x;
+    t.box.y = t.y;
+    t.box.w = w;
+    t.box.h = d.fontHeight(t.font);
+    strncpy(t.text, s, UI_TEXT_MAX - 1);
+    t.text[UI_TEXT_MAX - 1] = 0;
+    t.fg = fg;
+    t.bg = bg;
+    t.valid = true;
+    return true;
+}
+
+// Numeric field: v at the given decimals and a unit, redrawn when the text changes
+inline bool uiNumberDraw(DisplaySurface &d, UiText &t, float v, uint8_t decimals, const char *unit, uint16_t fg,
+                         uint16_t bg)
+{
+    char buf[UI_TEXT_MAX];
+    uiFormat(buf, sizeof(buf), v, decimals);
+    strncat(buf, unit, sizeof(buf) - strlen(buf) - 1);
+    return uiTextDraw(d, t, buf, fg, bg);
+}
+
+inline void uiBarPlace(UiBar &b, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t back)
+{
+    b.inner = UiRect{x, y, w, h};
+    b.back = back;
+    b.valid = false;
+}
+
+inline void uiBarInvalidate(UiBar &b)
+{
+    b.valid = false;
+}
+
+// Fill fillW pixels of the bar in color.  Only the strip between the old and the
+// new fill is drawn when the colour stays.  Returns true when drawn.
+inline bool uiBarDraw(DisplaySurface &d, UiBar &b, int16_t fillW, uint16_t color)
+{
+    const UiRect &r = b.inner;
+    fillW = (fillW < 0) ? 0 : (fillW > r.w) ? r.w : fillW;
+    if (b.valid && b.fillW == fillW && b.color == color)
+    {
+        return false;
+    }
+    if (b.valid && b.color == color)
+    {
+        if (fillW > b.fillW)
+        {
+            d.fillRect(r.x + b.fillW, r.y, fillW - b.fillW, r.h, color);
+        }
+        else
+        {
+            d.fillRect(r.x + fillW, r.y, b.fillW - fillW, r.h, b.back);
+        }
+    }
+    else
+    {
+        d.fillRect(r.x, r.y, fillW, r.h, color);
+        d.fillRect(r.x + fillW, r.y, r.w - fillW, r.h, b.back);
+    }
+    b.fillW = fillW;
+    b.color = color;
+    b.valid = true;
+    return true;
+}
@@ -15,7 +15,6 @@
 // Libraries
 #include <Arduino.h>
 // #include <Wire.h>
-#include <RunningAverage.h>
 #include <SPI.h>
 #include <Adafruit_GFX.h> // Core graphics library
 #include <TFT_eSPI.h>
@@ -23,16 +22,78 @@
 // #include <stdint.h>
 #include "pin_config.h"
 #include "version.h"
+#include "ads_session.h"
+#include "sampler.h"
+#include "gas_math.h"
+#include "filter_chain.h"
+#include "cal_engine.h"
+#include "settle_predictor.h"
+#include "stability.h"
+#include "spsc_queue.h"
+#include "telemetry.h"
+#include "double_buffer.h"
+#include "scheduler.h"
+#include "hal/hal.h"
+#include "hal/hal_arduino.h"
+#include "pipeline.h"
+#include "text_ui.h"
+#include "display_model.h"
+#include "dma_frames.h"
+#include "palette.h"
+#include "capture.h"
+#include "bench.h"
+#include "prof.h"
+#if defined(ESP32)
+#include "cal_store.h"
+#endif
 
 // Debugging
 #define DEBUG 1
+#ifndef LOG_LEVEL
+#if DEBUG == 1
+#define LOG_LEVEL LOG_INFO    // log.h, per subsystem with LOG_LEVEL_<tag>, e.g. -DLOG_LEVEL_CAL=LOG_TRACE
+#else
+#define LOG_LEVEL LOG_WARN    // warnings and errors stay in production builds
+#endif
+#endif
+#include "log.h"
+#define TELEMETRY 2           // 2= binary frames (telemetry.h) 1= text 0= off
+#define SERIAL_BAUD 921600    // match monitor_speed in platformio.ini
+#define TELEMETRY_TX_BUF 1024 // ESP32: UART TX ring the UART ISR empties
+#define CAPTURE 0   // raw conversions for host replay (capture.h): 1= to Serial 2= to flash (ESP32) 0= off
+#define CAPTURE_FILE "/capture.bin"      // CAPTURE 2: the last run, sent to Serial if the button is held at power up
+#define CAPTURE_MAX_BYTES (512UL * 1024) // CAPTURE 2: stop recording here
+#define CAPTURE_FLUSH_MS 1000            // CAPTURE 2: commit to flash at most this often
+#if CAPTURE == 2
+#if !defined(ESP32)
+#error "CAPTURE 2 needs the ESP32 flash file system, use CAPTURE 1"
+#endif
+#include <LittleFS.h>
+#endif
+#ifndef BENCH
+#define BENCH 0     // 1= time the hot paths, JSON report on Serial (bench.h), set by the *-bench envs
+#endif
+#define BENCH_REPORT_MS 10000
 
+#ifndef FIXED_MATH
+#define FIXED_MATH 0   // 1= integer / Q16.16 signal path, set per board in pin_config.h
+#endif
+
+// Stage profiling (prof.h), CPU cycles on the ESP32 boards.  'p' on Serial dumps
+// and resets the histograms.  Compiled out with DEBUG 0.
 #if DEBUG == 1
-#define debug(x) Serial.print(x)
-#define debugln(x) Serial.println(x)
+#if defined(ESP32)
+#define profNow() ESP.getCycleCount()
+#define PROF_UNIT "cycles"
+#else
+#define profNow() micros()
+#define PROF_UNIT "us"
+#endif
+#define profStart(stage) uint32_t profT_##stage = profNow()
+#define profStop(stage) profAdd(prof_##stage, profNow() - profT_##stage)
 #else
-#define debug(x)
-#define debugln(x)
+#define profStart(stage)
+#define profStop(stage)
 #endif
 
 // Display Definitions
@@ -48,21 +109,101 @@
 #define statinfo 1  // 2= bottom 1= top, 0= off [GUI requires off]
 #define MOD 1       // 1= on 0= off
 #define RODA 0      // 1= on 0= off
+#define FASTREAD 0  // 1= on 0= off   show the predicted final O2 while the cell settles
+
+// Task Settings ---------------------------------------------------------------------------
+// 2= core-pinned pipeline 1= sampling, render and telemetry tasks 0= all stages in loop()
+#if defined(ESP32) && portNUM_PROCESSORS > 1 && !defined(CONFIG_FREERTOS_UNICORE)
+#define TASKS 2
+#else
+#define TASKS 0         // single core C3 and SAMD boards: cooperative loop()
+#endif
+#define FRAME_MS 33     // render period, ~30 fps
+#define TELEMETRY_MS 50 // telemetry drain period
+#define SAMPLING_PRIO 5 // above the render and telemetry tasks
+#define RENDER_PRIO 2
+#define TELEMETRY_PRIO 1
+#define SAMPLING_CORE 0 // TASKS 2: acquisition and filtering
+#define RENDER_CORE 1   // TASKS 2: compositing and SPI DMA, where setup() drew
+#define BAT_MS 5000     // battery read period
+#define REPORT_MS 10000 // TASKS 0: job statistics to Serial
+#define ADC_WARN_MS 5000 // ADC recovery warning repeat period
 
 
 // Init tft and sprites
 TFT_eSPI tft = TFT_eSPI();
 
-TFT_eSprite gauge = TFT_eSprite(&tft);
-TFT_eSprite background = TFT_eSprite(&tft);
-TFT_eSprite needle = TFT_eSprite(&tft);
-  
+DmaFrames gaugeFrames(tft); // gauge strips, one drawn while the other streams out
+
 // Init ADS
 Adafruit_ADS1115 ads; // Define ADC - 16-bit version
+AdsSession adc;       // Configured once in setup(), health checked per read
+Sampler sampler;      // Continuous conversions paced by the data rate, or ALERT/RDY where wired
+
+// Hardware behind the HAL interfaces
+TftSurface tftSurface(tft);
+SamplerAdc samplerAdc(sampler);
+BoardBattery battery;
+PinButton button(BUTTON_PIN);
+ArduinoClock sysClock;
+
+#if CAPTURE != 0
+// Every conversion read goes through the recorder on its way to the pipeline
+CaptureWriter captureWriter;
+CaptureAdc adcSource(samplerAdc, sysClock, captureWriter);
+SpscQueue<CaptureChunk, 8> captureQueue; // sampling -> telemetry
+bool captureDirect = true;                // setup() writes chunks itself, no tasks yet
+#if CAPTURE == 2
+File captureFile;
+#endif
+#else
+SamplerAdc &adcSource = samplerAdc;
+#endif
+
+#if DEBUG == 1
+// Stages timed by profStart() / profStop()
+ProfStage prof_adc("adc");         // a conversion taken from the sampler
+ProfStage prof_filter("filter");   // one filter chain update
+ProfStage prof_gasmath("gasmath"); // pipelineProcess()
+ProfStage prof_battery("battery");
+ProfStage prof_debug("debug");     // one telemetry record sent
+ProfStage prof_layout("layout");   // a text frame or one gauge strip drawn
+ProfStage prof_push("push");       // one gauge strip to the panel
+ProfStage *const profStages[] = {&prof_adc, &prof_filter, &prof_gasmath, &prof_battery, &prof_debug, &prof_layout, &prof_push};
+#endif
+
+#if BENCH == 1
+// Timed paths, see bench.h
+BenchStat benchAcquire("acquire", "us");        // conversion ready to filtered sample queued
+BenchStat benchFilter("filter", "us");          // one filter chain update
+BenchStat benchLoop("loop", "us");              // a loop() pass over every due job, or a pass of the task that draws
+BenchStat benchFrame(GUI == 1 ? "frame_gauge" : "frame_text", "us"); // renderStage()
+BenchStat benchCal("calibration", "ms");        // full calibration or warm start
+BenchStat benchBoot("boot_to_reading", "ms");   // power up to the first reading drawn
+BenchStat *const benchStats[] = {&benchAcquire, &benchFilter, &benchLoop, &benchFrame, &benchCal, &benchBoot};
+#endif
 
 // Running Average definitions
 #define RA_SIZE 20          // Define running average pool size
-RunningAverage RA(RA_SIZE); // Initialize Running Average
+
+// Loop filter: spike rejection -> smoothing -> averaging, chosen per board
+#ifndef SAMPLE_FILTER
+#define SAMPLE_FILTER FilterChain<Median<5>, Ema<2>, Window<RA_SIZE>>
+#endif
+SAMPLE_FILTER sampleFilter;
+
+// Filtered sample handed from the sampling stage to the render stage
+struct Sample
+{
+  uint32_t us;      // micros() when the conversion was filtered
+  int16_t raw;      // conversion as read
+  int32_t filtered; // chain output, counts scaled by 2^FILTER_FRAC
+};
+
+SpscQueue<Sample, 64> sampleQueue;             // sampling -> processing
+SpscQueue<TelemetryRecord, 16> telemetryQueue; // processing -> telemetry
+
+DoubleBuffer<Reading> readingBuffer; // acquisition core -> display core (TASKS 2)
 
 // Global Variables
 int LCDROT = 0; // 0 = default, 1 = CW 90
@@ -72,18 +213,27 @@ float prevaveSensorValue = 0;
 float aveSensorValue = 0;
 float mVolts = 0;
 float batVolts = 0;
-float prevO2 = 0;
 float currentO2 = 0;
-float calFactor = 1;
-float calErrChk = 1;
 int mod14fsw = 0;
 int mod14msw = 0;
 int mod16fsw = 0;
 int mod16msw = 0;
-float modppo = 1.4;
-float mod16ppo = 1.6;
-float multiplier = 0;
 int msgid = 0;
+volatile float batteryV = 0; // latest batStat() reading, refreshed every BAT_MS
+
+#if TASKS == 0
+Scheduler scheduler; // runs the stages as periodic jobs
+#endif
+
+Pipeline pipe; // Calibration, stability and fast readout state
+TextUi ui;     // Text layout and fault screens on tftSurface
+
+bool stable = false;     // display copy of the STABLE flag
+bool predicting = false; // currentO2 holds the FASTREAD prediction while predicting
+
+#if defined(ESP32)
+CalRecord calRecord; // Last full calibration, kept in flash
+#endif
 
 #if GUI == 1
 // Define display colors
@@ -99,6 +249,38 @@ int msgid = 0;
 
 #define DEG2RAD 0.0174532925
 
+// Every colour on the gauge, a strip holds 4 bit indices into it (palette.h)
+// and is expanded to RGB565 on its way to the panel
+constexpr uint16_t gaugePalette[PALETTE_SIZE] = {
+    backColor, color5, TFT_DARKCYAN, TFT_DARKGREEN, color1, color3, TFT_CYAN, TFT_YELLOW,
+    TFT_RED, TFT_GREEN, TFT_SILVER, TFT_GREENYELLOW, TFT_BLUE, gaugeColor, dataColor, needleColor};
+
+// The gauge is drawn and sent a band of rows at a time, through a strip of
+// TFT_WIDTH x GAUGE_STRIP_H: 2.9 KB at 24 rows and 4 bpp.  GAUGE_BPP 16 draws
+// RGB565 into two strips (one on SAMD) of 11.5 KB each instead.
+#ifndef GAUGE_STRIP_H
+#define GAUGE_STRIP_H 24
+#endif
+#ifndef GAUGE_BPP
+#define GAUGE_BPP 4
+#endif
+#if GAUGE_BPP == 4
+#define gaugeInk(c) PALETTE_INDEX(gaugePalette, c) // what a strip takes for colour c
+#else
+#define gaugeInk(c) (c)
+#endif
+#define GAUGE_H 240
+#if GAUGE_H % GAUGE_STRIP_H != 0
+#error "GAUGE_STRIP_H must divide the gauge height"
+#endif
+
+// Display model parts the gauge sprite shows
+#if statinfo != 0
+#define GAUGE_CHANGES (DM_O2 | DM_MOD | DM_STABLE | DM_SENSOR | DM_BATTERY)
+#else
+#define GAUGE_CHANGES (DM_O2 | DM_MOD | DM_STABLE)
+#endif
+
 // Gauge variables
 float o2Angle = 0;  // range 0-100
 float modAngle = 0; // range 10-250
@@ -116,29 +298,23 @@ int modOffAgl = 270;
 
 String o2[10] = {"0", "10", "20", "30", "40", "50", "60", "70", "80", "90"};
 String mod[10] = {"0", "30", "60", "90", "120", "150", "180", "210", "240", "270"};
-int o2Start[10];
-int o2StartP[60];
-int modStart[10];
-int modStartP[60];
 
-float x[360]; // pixel points O2 gauge
-float y[360];
-float px[360]; // line end points O2 gauge
-float py[360];
-float lx[360]; // text of O2 gauges
-float ly[360];
-
-float x2[360]; // outer points of MOD gauges
-float y2[360];
-float px2[360]; // ineer point of MOD gauges
-float py2[360];
-float lx2[360]; // text of MOD gauges
-float ly2[360];
+// Scale marks of one dial at its current angle, worked out once a frame and
+// drawn into every strip: a label and a line every 36 degrees, a dot every 6
+struct GaugeMarks
+{
+  int16_t tx[10]; // label
+  int16_t ty[10];
+  int16_t px[60]; // pick marks, and the outer end of the lines
+  int16_t py[60];
+  int16_t lx[10]; // line ends
+  int16_t ly[10];
+};
+GaugeMarks o2Marks;
+GaugeMarks modMarks;
 
 #endif
 
-const int buttonPin = BUTTON_PIN; // push button
-
 // Functions
 float batStat();
 
@@ -157,56 +333,24 @@ float batStat();
   //esp_light_sleep_start();
 }*/
 
-void SenseFault()
-{
-  debugln("Low mV reading from Sensor");
-  tft.fillScreen(TFT_YELLOW);
-  tft.setTextColor(TFT_RED);
-  tft.setTextSize(1 * ResFact);
-  tft.drawCentreString("Error", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.1, 4);
-  tft.drawCentreString("Sensor mV", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.4, 4);
-  tft.drawCentreString("LOW", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.7, 4);
-  tft.setTextSize(1);
-  tft.drawCentreString(String(mVolts), TFT_WIDTH * .5, TFT_HEIGHT * 0.8, 4);
-  delay(30000);
-}
-
-void BattFault()
-{
-  debugln("Low V reading from Battery");
-  tft.fillScreen(TFT_YELLOW);
-  tft.setTextColor(TFT_RED);
-  tft.setTextSize(1 * ResFact);
-  tft.drawCentreString("Error", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.1, 4);
-  tft.drawCentreString("Battery", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.4, 4);
-  tft.drawCentreString("Low", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.7, 4);
-  tft.setTextSize(1);
-  tft.drawCentreString(String(batVolts), TFT_WIDTH * .5, TFT_HEIGHT * 0.8, 4);
-  delay(30000);
-}
-
 float initADC()
 {
-  // init ADC and Set gain
+  // init ADC and Set gain, once from setup()
 
-  // The ADC input range (or gain) can be changed via the following
+  // The ADC input range (or gain) can be changed via ADS_GAIN in ads_session.h
   //                                                                ADS1015  ADS1115
   //                                                                -------  -------
   // ads.setGain(GAIN_TWOTHIRDS);  // 2/3x gain +/- 6.144V  1 bit = 3mV      0.1875mV (default)
   // ads.setGain(GAIN_ONE);        // 1x gain   +/- 4.096V  1 bit = 2mV      0.125mV
-  ads.setGain(GAIN_TWO); // 2x gain   +/- 2.048V  1 bit = 1mV      0.0625mV
+  // ads.setGain(GAIN_TWO);        // 2x gain   +/- 2.048V  1 bit = 1mV      0.0625mV
   // ads.setGain(GAIN_FOUR);       // 4x gain   +/- 1.024V  1 bit = 0.5mV    0.03125mV
   // ads.setGain(GAIN_EIGHT);      // 8x gain   +/- 0.512V  1 bit = 0.25mV   0.015625mV
   // ads.setGain(GAIN_SIXTEEN);    // 16x gain  +/- 0.256V  1 bit = 0.125mV  0.0078125mV
 
-  /* Be sure to update this value based on the IC and the gain settings! */
-  // float   multiplier = 3.0F;    /* ADS1015 @ +/- 6.144V gain (12-bit results) */
-  float multiplier = 0.0625; /* ADS1115  @ +/- 6.144V gain (16-bit results) */
-
   // Check that the ADC is operational
-  if (!ads.begin())
+  if (!adsOpen(adc, ads))
   {
-    debugln("Failed to initialize ADC.");
+    logE(ADC, "failed to initialize");
     tft.fillScreen(TFT_YELLOW);
     tft.setTextColor(TFT_RED);
     tft.setTextSize(1 * ResFact);
@@ -216,62 +360,44 @@ float initADC()
     delay(30000);
     while (1);
   }
-  return (multiplier);
+  return (adc.multiplier);
 }
 
-void o2calibration()
+void CalFault()
 {
-  int cal = 1;
-  do
-  {
-    // display "Calibrating"
-    tft.fillScreen(TFT_BLACK);
-    tft.setTextColor(TFT_WHITE);
-    tft.setTextSize(1 * ResFact);
-    tft.drawCentreString("+++++++++++++", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.1, 2);
-    tft.drawCentreString("Calibrating", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.3, 2);
-    tft.drawCentreString("O2 Sensor", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.6, 2);
-    tft.drawCentreString("+++++++++++++", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.8, 2);
-    debugln("Calibration Screen Text");
-
-    // get running average value from ADC input Pin
-    RA.clear(); 
-    for (int x = 0; x <= (RA_SIZE * 3); x++)
-    {
-      int sensorValue = 0;
-      sensorValue = abs(ads.readADC_Differential_0_1());
-      RA.addValue(sensorValue);
-      delay(12); // was 8
-    }
-    debug("Average calibration read ");
-    debugln(RA.getAverage()); // average cal factor serial print for debugging
-    calFactor = RA.getAverage();
-    delay(1000); // Slow the loop for checksum
-
-    // Checksum on calibrate ... is the sensor still reseting from earlier read
-    RA.clear();
-    for (int x = 0; x <= (RA_SIZE * 3); x++)
-    {
-      int sensorValue = 0;
-      sensorValue = abs(ads.readADC_Differential_0_1());
-      RA.addValue(sensorValue);
-      delay(36); // was 24
-    }
-
-    tft.fillScreen(TFT_BLACK);
-
-    calErrChk = RA.getAverage();
-    debug("calibration raw values Calfactor=");
-    debug(calFactor); // average cal factor
-    debug(" CalErrChk=");
-    debugln(calErrChk); // average cal err factor serial print for debugging
-
-    debugln(abs((calFactor / calErrChk) - 1) * 100);
+  logW(CAL, "did not settle");
+  tft.fillScreen(TFT_YELLOW);
+  tft.setTextColor(TFT_RED);
+  tft.setTextSize(1 * ResFact);
+  tft.drawCentreString("Error", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.1, 4);
+  tft.drawCentreString("Calibrate", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.4, 4);
+  tft.drawCentreString("Retry", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.7, 4);
+  delay(5000);
+}
 
-    // checking against a 0.5% error
-    if (abs((calFactor / calErrChk) - 1) * 100 > 0.5)
+// Sample until the mean is tight and the sensor has stopped drifting, or time out
+bool o2calibration()
+{
+  // display "Calibrating"
+  tft.fillScreen(TFT_BLACK);
+  tft.setTextColor(TFT_WHITE);
+  tft.setTextSize(1 * ResFact);
+  tft.drawCentreString("+++++++++++++", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.1, 2);
+  tft.drawCentreString("Calibrating", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.3, 2);
+  tft.drawCentreString("O2 Sensor", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.6, 2);
+  tft.drawCentreString("+++++++++++++", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.8, 2);
+  logT(CAL, "calibrating");
+
+  CalEngine cal;
+  calBegin(cal, millis());
+  uint8_t restarts = 0;
+  while (calAdd(cal, millis(), abs(adcSource.next())) == CAL_RUNNING)
+  {
+    // the sensor is still reseting from an earlier read
+    if (cal.restarts != restarts)
     {
-      debugln("Calibration Checksum out of spec");
+      restarts = cal.restarts;
+      logW(CAL, "drifting %s %%/s, restarting window", LogFloat(cal.driftPct, 3).s);
       tft.fillScreen(TFT_ORANGE);
       tft.setTextColor(TFT_BLACK);
       tft.setTextSize(1 * ResFact);
@@ -280,122 +406,268 @@ void o2calibration()
       tft.drawCentreString("Calibration", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.45, 2);
       tft.drawCentreString("Standby", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.65, 2);
       tft.drawCentreString("+++++++++++++", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.80, 2);
-      tft.drawCentreString(String(abs((calFactor / calErrChk) - 1) * 100), TFT_WIDTH * 0.5, TFT_HEIGHT * 0.80, 1);
-      delay(2000);
-      cal = 1;
+      tft.drawCentreString(String(cal.driftPct), TFT_WIDTH * 0.5, TFT_HEIGHT * 0.80, 1);
     }
-    else
-    {
-      cal = 0;
-    }
-  } while (cal);
+  }
 
-  calFactor = (1 / RA.getAverage() * 20.900); // Auto Calibrate to 20.9%
+  tft.fillScreen(TFT_BLACK);
+
+  logI(CAL, "raw mean=%s CI%%=%s drift%%/s=%s ms=%lu", LogFloat(calMean(cal)).s, LogFloat(cal.ciPct).s,
+       LogFloat(cal.driftPct, 3).s, (unsigned long)(millis() - cal.startMs));
+
+  if (cal.state == CAL_FAILED)
+  {
+    return false;
+  }
+
+  pipelineCalibrate(pipe, cal.sum, cal.count); // Auto Calibrate to 20.9%
+
+#if defined(ESP32)
+  calRecord.calFactor = pipe.calFactor;
+#if FIXED_MATH == 1
+  calRecord.calFactorQ = pipe.calFactorQ;
+#endif
+  calRecord.airCounts = calMean(cal);
+  calRecord.airMv = calMean(cal) * pipe.multiplier;
+  calRecord.chipId = chipId;
+  calSave(calRecord);
+  calSetWarmBoots(0);
+  logI(CAL, "stored");
+#endif
+  return true;
 }
 
-void BatGauge(int locX, int locY, float batV)
+#if defined(ESP32)
+// Short read in air against the stored calibration, skips o2calibration() when it matches
+bool warmStart()
 {
+  if (!calLoad(calRecord, chipId))
+  {
+    logI(CAL, "none stored");
+    return false;
+  }
 
-#if GUI == 1
-  // Add to gauge sprite
-  gauge.drawRect(locX, locY, 25, 12, TFT_WHITE);
-  gauge.drawRect((locX + 25), (locY + 4), 3, 4, TFT_WHITE);
-  gauge.fillRect((locX + 1), (locY + 1), 23, 10, TFT_BLACK);
+  tft.fillScreen(TFT_BLACK);
+  tft.setTextColor(TFT_WHITE);
+  tft.setTextSize(1 * ResFact);
+  tft.drawCentreString("Checking", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.3, 2);
+  tft.drawCentreString("O2 Sensor", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.6, 2);
 
-  // Fill with the color that matches the charge state
-  if (batV >= 3.4 and batV < 3.6)
+  uint32_t warmBoots = calWarmBoots();
+  TrendStats air;
+  uint32_t start = millis();
+  while ((millis() - start) < CAL_VERIFY_MS)
   {
-    gauge.fillRect((locX + 1), (locY + 1), 15, 10, TFT_YELLOW);
+    trendAdd(air, (millis() - start) / 1000.0f, abs(adcSource.next()));
   }
-  if (batV < 3.4)
+  tft.fillScreen(TFT_BLACK);
+
+  logI(CAL, "stored air counts=%s measured=%s warm boots=%lu", LogFloat(calRecord.airCounts).s,
+       LogFloat(air.meanY).s, (unsigned long)warmBoots);
+
+  if (!calVerify(calRecord, warmBoots, air.meanY))
   {
-    gauge.fillRect((locX + 1), (locY + 1), 10, 10, TFT_RED);
+    logW(CAL, "stored calibration out of tolerance");
+    return false;
   }
-  if (batV >= 3.6)
+
+  pipe.calFactor = calRecord.calFactor;
+#if FIXED_MATH == 1
+  pipe.calFactorQ = calRecord.calFactorQ;
+#endif
+  calSetWarmBoots(warmBoots + 1); // the record itself stays as the calibration wrote it
+  return true;
+}
+#endif
+
+// Take a conversion if one is ready
+bool sampleTake(int16_t &sensorValue)
+{
+  profStart(adc);
+  if (!adcSource.take(sensorValue))
   {
-    gauge.fillRect((locX + 1), (locY + 1), 23, 10, TFT_GREEN);
+    return false;
   }
-#else
-  // Draw the outline and clear the box
-  tft.drawRect(locX, locY, 25, 12, TFT_WHITE);
-  tft.drawRect((locX + 25), (locY + 4), 3, 4, TFT_WHITE);
-  tft.fillRect((locX + 1), (locY + 1), 23, 10, TFT_BLACK);
+  profStop(adc);
+  return true;
+}
 
-  // Fill with the color that matches the charge state
-  if (batV > 3.4 and batV < 3.6)
+void samplePublish(int16_t sensorValue)
+{
+  Sample s;
+  s.us = micros();
+  s.raw = sensorValue;
+  profStart(filter);
+  s.filtered = sampleFilter.apply(filterIn(abs(sensorValue)));
+  profStop(filter);
+#if BENCH == 1
+  benchAdd(benchFilter, micros() - s.us);
+#endif
+  sampleQueue.push(s); // a full queue drops the sample, never blocks
+}
+
+// Sampling stage: waits for the next conversion, then feeds it and any others
+// already ready through the filter chain and publishes each with its timestamp
+void sampleStage()
+{
+  int16_t sensorValue = adcSource.next(); // sleeps until the conversion is due, no fixed delay
+  do
   {
-    tft.fillRect((locX + 1), (locY + 1), 15, 10, TFT_YELLOW);
-  }
-  if (batV < 3.4)
+    samplePublish(sensorValue);
+  } while (sampleTake(sensorValue));
+#if BENCH == 1
+  benchAdd(benchAcquire, micros() - sampler.readyUs);
+#endif
+}
+
+// Same without waiting: take whatever conversions are ready, for the scheduler
+void sampleDrain()
+{
+  int16_t sensorValue;
+  if (!sampleTake(sensorValue))
   {
-    tft.fillRect((locX + 1), (locY + 1), 10, 10, TFT_RED);
+    return;
   }
-  if (batV > 3.6)
+  do
   {
-    tft.fillRect((locX + 1), (locY + 1), 23, 10, TFT_GREEN);
-  }
+    samplePublish(sensorValue);
+  } while (sampleTake(sensorValue));
+#if BENCH == 1
+  benchAdd(benchAcquire, micros() - sampler.readyUs);
 #endif
-  if (batV < 3.2) { BattFault(); }
+}
 
+void batteryStage()
+{
+  profStart(battery);
+  batteryV = battery.volts(); // Battery Check ESP based boards
+  profStop(battery);
 }
 
-void SenseGauge(int locX, int locY, float senV)
+// Log sink: each line goes out in one write, so lines from different tasks do not mix
+void logSerial(const LogLine &line)
 {
+  Serial.write((const uint8_t *)line.text, line.len);
+}
 
-#if GUI == 1
-  // Draw the outline and clear the box
-  gauge.drawRect(locX, locY, 25, 12, TFT_WHITE);
-  gauge.drawRect((locX + 5), (locY - 3), 4, 3, TFT_WHITE);
-  gauge.drawRect((locX + 16), (locY - 3), 4, 3, TFT_WHITE);
-  gauge.fillRect((locX + 1), (locY + 1), 23, 10, TFT_BLACK);
+uint32_t logClock()
+{
+  return millis();
+}
 
-  // Fill with the color that matches the charge state
-  if (senV >= 9.0)
+#if DEBUG == 1
+void profOut(const char *s)
+{
+  Serial.print(s);
+}
+
+// Serial commands: p = dump the stage profile and start a new one
+void commandStage()
+{
+  while (Serial.available() > 0)
   {
-    gauge.fillRect((locX + 1), (locY + 1), 23, 10, TFT_BLUE);
+    if (Serial.read() == 'p')
+    {
+      uint8_t count = sizeof(profStages) / sizeof(profStages[0]);
+      profDump(profStages, count, PROF_UNIT, profOut);
+      for (uint8_t i = 0; i < count; i++)
+      {
+        profReset(*profStages[i]);
+      }
+    }
   }
-  if (senV >= 8 and senV < 9.0 )
+}
+#endif
+
+#if BENCH == 1
+void benchOut(const char *s)
+{
+  Serial.print(s);
+}
+
+// Benchmark report as one JSON line, from the telemetry side every BENCH_REPORT_MS
+void benchStage()
+{
+  benchReport(benchStats, sizeof(benchStats) / sizeof(benchStats[0]), VERSION, VAL_MCU, benchOut);
+}
+#endif
+
+#if CAPTURE != 0
+void captureWrite(const CaptureChunk &c)
+{
+#if CAPTURE == 1
+  Serial.write(c.data, c.len); // debug text in between is skipped by the reader
+#else
+  if (captureFile && captureFile.size() + c.len <= CAPTURE_MAX_BYTES)
   {
-    gauge.fillRect((locX + 1), (locY + 1), 23, 10, TFT_GREEN);
+    captureFile.write(c.data, c.len);
   }
-  if (senV > 7.5 and senV < 8.0)
+#endif
+}
+
+// Capture writer output: written straight away during setup(), handed to the
+// telemetry stage once the sampling must not wait on Serial or flash
+void captureEmit(const CaptureChunk &c)
+{
+  if (captureDirect)
   {
-    gauge.fillRect((locX + 1), (locY + 1), 23, 10, TFT_YELLOW);
+    captureWrite(c);
   }
-  if (senV <= 7.5)
+  else
   {
-    gauge.fillRect((locX + 1), (locY + 1), 23, 10, TFT_RED);
+    captureQueue.push(c); // a full queue drops the chunk, the replay sees a gap
   }
+}
 
-#else
-  // Draw the outline and clear the box
-  tft.drawRect(locX, locY, 25, 12, TFT_WHITE);
-  tft.drawRect((locX + 5), (locY - 3), 4, 3, TFT_WHITE);
-  tft.drawRect((locX + 16), (locY - 3), 4, 3, TFT_WHITE);
-  tft.fillRect((locX + 1), (locY + 1), 23, 10, TFT_BLACK);
-
-  // Fill with the color that matches the charge state
-  if (senV > 7.5 and senV < 8.0)
+// Telemetry side of the capture: write out the finished chunks
+void captureStage()
+{
+  CaptureChunk c;
+  while (captureQueue.pop(c))
   {
-    tft.fillRect((locX + 1), (locY + 1), 23, 10, TFT_YELLOW);
+    captureWrite(c);
   }
-  if (senV >= 8 and senV < 9.0 )
+#if CAPTURE == 2
+  static uint32_t flushed = 0;
+  if (captureFile && (millis() - flushed) >= CAPTURE_FLUSH_MS)
   {
-    tft.fillRect((locX + 1), (locY + 1), 23, 10, TFT_GREEN);
+    flushed = millis();
+    captureFile.flush(); // a unit switched off keeps all but the last second
   }
-  if (senV <= 7.5)
+#endif
+}
+
+// Start recording, from setup() before the calibration
+void captureBegin()
+{
+#if CAPTURE == 2
+  if (!LittleFS.begin(true))
   {
-    tft.fillRect((locX + 1), (locY + 1), 23, 10, TFT_RED);
+    logE(CAP, "no flash file system");
   }
-  if (senV >= 9.0)
+  else
   {
-    tft.fillRect((locX + 1), (locY + 1), 23, 10, TFT_BLUE);
+    if (BUTTON_PIN >= 0 && button.pressed() && LittleFS.exists(CAPTURE_FILE))
+    {
+      // Read out the last run before it is overwritten
+      logI(CAP, "sending the last run");
+      File last = LittleFS.open(CAPTURE_FILE, "r");
+      uint8_t buf[256];
+      size_t n;
+      while ((n = last.read(buf, sizeof(buf))) > 0)
+      {
+        Serial.write(buf, n);
+      }
+      last.close();
+      Serial.flush();
+      logI(CAP, "sent");
+    }
+    captureFile = LittleFS.open(CAPTURE_FILE, "w");
   }
 #endif
-
-if (senV < 7.1) { SenseFault(); }
-
+  capBegin(captureWriter, adsRateSps(adc.dataRate), adcSource.mvPerCount(), captureEmit);
 }
+#endif
 
 void testfillcircles(uint8_t radius, uint16_t color)
 {
@@ -459,240 +731,233 @@ void safetyrule()
   tft.fillScreen(TFT_BLACK);
 }
 
-void displayUtilData()
+#if GUI == 1
+// Sensor and battery gauges on the gauge sprite, the text layout has its own in text_ui.h
+void BatGauge(TFT_eSprite &gauge, int locX, int locY, float batV)
 {
 
-  BatGauge((TFT_WIDTH * 0.8), (TFT_HEIGHT * (tbFactor + 0.02)), (batVolts));
-  SenseGauge((TFT_WIDTH * 0.1), (TFT_HEIGHT * (tbFactor + 0.02)), (mVolts));
-
-  // Stats for nerds text
-  #if (nerds == 1 and GUI == 0)
+  // Add to gauge sprite
+  gauge.drawRect(locX, locY, 25, 12, gaugeInk(TFT_WHITE));
+  gauge.drawRect((locX + 25), (locY + 4), 3, 4, gaugeInk(TFT_WHITE));
+  gauge.fillRect((locX + 1), (locY + 1), 23, 10, gaugeInk(TFT_BLACK));
 
-    tft.setTextSize(1);
-    if (mVolts > 7.5 and mVolts <= 9.0) { tft.setTextColor(TFT_YELLOW, TFT_BLACK); }
-    if (mVolts <= 7.5) { tft.setTextColor(TFT_RED, TFT_BLACK); }
-    if (mVolts > 9.0) { tft.setTextColor(TFT_SKYBLUE, TFT_BLACK); }
-    if (mVolts < 7.1) { SenseFault(); }
-    String mv = String(mVolts, 1);
+  // Fill with the color that matches the charge state
+  if (batV >= 3.4 and batV < 3.6)
+  {
+    gauge.fillRect((locX + 1), (locY + 1), 15, 10, gaugeInk(TFT_YELLOW));
+  }
+  if (batV < 3.4)
+  {
+    gauge.fillRect((locX + 1), (locY + 1), 10, 10, gaugeInk(TFT_RED));
+  }
+  if (batV >= 3.6)
+  {
+    gauge.fillRect((locX + 1), (locY + 1), 23, 10, gaugeInk(TFT_GREEN));
+  }
 
-    tft.drawCentreString(String(mv + " mV "), TFT_WIDTH * 0.18, TFT_HEIGHT * 0.1, 2);
+}
 
-    if (batVolts > 3.4 and batVolts < 3.6) { tft.setTextColor(TFT_YELLOW, TFT_BLACK); }
-    if (batVolts < 3.4) { tft.setTextColor(TFT_RED, TFT_BLACK); }
-    if (batVolts > 3.6) { tft.setTextColor(TFT_GREEN, TFT_BLACK); }
+void SenseGauge(TFT_eSprite &gauge, int locX, int locY, float senV)
+{
 
-    String bv = String(batVolts, 1);
-    if (batVolts < 3.2) { BattFault(); }
+  // Draw the outline and clear the box
+  gauge.drawRect(locX, locY, 25, 12, gaugeInk(TFT_WHITE));
+  gauge.drawRect((locX + 5), (locY - 3), 4, 3, gaugeInk(TFT_WHITE));
+  gauge.drawRect((locX + 16), (locY - 3), 4, 3, gaugeInk(TFT_WHITE));
+  gauge.fillRect((locX + 1), (locY + 1), 23, 10, gaugeInk(TFT_BLACK));
 
-    tft.drawCentreString(String(bv + " V  "), TFT_WIDTH * 0.88, TFT_HEIGHT * 0.1, 2);
+  // Fill with the color that matches the charge state
+  if (senV >= 9.0)
+  {
+    gauge.fillRect((locX + 1), (locY + 1), 23, 10, gaugeInk(TFT_BLUE));
+  }
+  if (senV >= 8 and senV < 9.0 )
+  {
+    gauge.fillRect((locX + 1), (locY + 1), 23, 10, gaugeInk(TFT_GREEN));
+  }
+  if (senV > 7.5 and senV < 8.0)
+  {
+    gauge.fillRect((locX + 1), (locY + 1), 23, 10, gaugeInk(TFT_YELLOW));
+  }
+  if (senV <= 7.5)
+  {
+    gauge.fillRect((locX + 1), (locY + 1), 23, 10, gaugeInk(TFT_RED));
+  }
 
-    //tft.drawString(String(millis() / 1000), TFT_WIDTH * 0.05, TFT_HEIGHT * 0, 2);
-    tft.setTextSize(1);
-    tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
-    tft.drawCentreString(String(VERSION), TFT_WIDTH * 0.5, TFT_HEIGHT * 0.93, 2);
-  #endif
 }
 
-#if GUI == 0
-void textBaseLayout()
+void displayUtilData(TFT_eSprite &gauge)
 {
-  // Draw Layout -- Adjust this layouts to suit you LCD
-
-  tft.setTextColor(TFT_MAGENTA, TFT_BLACK);
-  tft.setTextSize(1 * ResFact);
-  tft.drawCentreString("O %", TFT_WIDTH * 0.5, TFT_HEIGHT * 0, 4);
-  tft.setTextSize(1);
-  tft.drawCentreString("2", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.1, 4);
-  tft.setTextSize(1 * ResFact);
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  if (MOD == 1)
+  if (ui.cfg.showBattery)
   {
-    tft.drawCentreString("@1.4  MOD  @1.6", TFT_WIDTH * 0.5, TFT_HEIGHT * 0.62, 2);
+    BatGauge(gauge, (TFT_WIDTH * 0.8), (TFT_HEIGHT * (tbFactor + 0.02)), (batVolts));
   }
-  
-  debugln("Base layout");
+  SenseGauge(gauge, (TFT_WIDTH * 0.1), (TFT_HEIGHT * (tbFactor + 0.02)), (mVolts));
 }
 
-void displayTextData()
+// Low battery and sensor fault screens, drawn straight on the panel
+void gaugeFaults()
 {
-  // Generate Text layout
-  if (prevO2 != currentO2)
+  bool lowBattery = ui.cfg.showBattery && batVolts < 3.2; // no monitor on SAMD
+  if (lowBattery || mVolts < 7.1)
   {
-    if (currentO2 > 19.5 and currentO2 < 22)
-    {
-      tft.setTextColor(TFT_CYAN, TFT_BLACK);
-    }
-    if (currentO2 <= 19.5)
-    {
-      tft.setTextColor(TFT_YELLOW, TFT_BLACK);
-    }
-    if (currentO2 <= 17)
-    {
-      tft.setTextColor(TFT_RED, TFT_BLACK);
-    }
-    if (currentO2 >= 22)
-    {
-      tft.setTextColor(TFT_GREEN, TFT_BLACK);
-    }
-
-    // Draw Text Layout -- Adjust these layouts to suit you LCD
-    tft.setTextSize(1 * ResFact);
-    String o2 = String(currentO2, 1);
-    float h = 0.22;
-    if (MOD == 0)
-    {
-      h = 0.35;
-    }
-
-    tft.drawCentreString(o2, TFT_WIDTH * 0.5, TFT_HEIGHT * h, 7);
-    debugln("Write O2 string");
-  
-    tft.setTextSize(1 * ResFact);
-    if (MOD == 1)
-    {
-      if (metric == 1)
-      {
-        String mod14m = String(mod14msw);
-        tft.setTextColor(TFT_GREENYELLOW, TFT_BLACK);
-        tft.drawString(String(mod14m + "-m  "), TFT_WIDTH * 0.05, TFT_HEIGHT * 0.75, 2);
-        tft.setTextColor(TFT_GOLD, TFT_BLACK);
-        String mod16m = String(mod16msw);
-        tft.drawString(String(mod16m + "-m  "), TFT_WIDTH * 0.7, TFT_HEIGHT * 0.75, 2);
-      }
-      else
-      {
-        tft.setTextColor(TFT_GREENYELLOW, TFT_BLACK);
-        String mod14f = String(mod14fsw);
-        tft.drawString(String(mod14f + "-FT  "), TFT_WIDTH * 0, TFT_HEIGHT * 0.75, 2);
-        tft.setTextColor(TFT_GOLD, TFT_BLACK);
-        String mod16f = String(mod16fsw);
-        tft.drawString(String(mod16f + "-FT  "), TFT_WIDTH * 0.6, TFT_HEIGHT * 0.75, 2);
-      }
-    }
+    gaugeFrames.wait(); // not while a frame is on the bus
   }
+  if (lowBattery) { uiBattFault(ui, batVolts, millis()); }
+  if (mVolts < 7.1) { uiSenseFault(ui, mVolts, millis()); }
 }
-#endif
 
-#if GUI == 1
 void gaugeBaseLayout()
 {
   // Draw Layout -- Adjust this layouts to suit you LCD
-  gauge.createSprite(TFT_WIDTH, 240);
-  gauge.setSwapBytes(true);
-  gauge.setTextDatum(4);
-  gauge.setTextColor(TFT_WHITE, backColor);
-  needle.createSprite(TFT_WIDTH, 240);
-  needle.setSwapBytes(true);
-  background.createSprite(TFT_WIDTH, 240);
-  background.setSwapBytes(true);
-  background.fillSprite(TFT_BLACK);
-
-  int b = 0;
-  int b2 = 0;
-  int c = 0;
-  int c2 = 0;
-
-  // Set up polar coordinates for gauge
-  for (int i = 0; i < 360; i++)
-  {
-    x[i] = ((r)*cos(DEG2RAD * i)) + centerX; // Shading
-    y[i] = ((r)*sin(DEG2RAD * i)) + centerY;
-    px[i] = ((r - 14) * cos(DEG2RAD * i)) + centerX; // pick marks
-    py[i] = ((r - 14) * sin(DEG2RAD * i)) + centerY;
-    lx[i] = ((r - 24) * cos(DEG2RAD * i)) + centerX; // line ends
-    ly[i] = ((r - 24) * sin(DEG2RAD * i)) + centerY;
-
-    if (i % 36 == 0)
-    {
-      o2Start[b] = i;
-      b++;
-    }
-
-    if (i % 6 == 0)
-    {
-      o2StartP[b2] = i;
-      b2++;
-    }
-
-    x2[i] = ((r)*cos(DEG2RAD * i)) + centerX2; // Shading
-    y2[i] = ((r)*sin(DEG2RAD * i)) + centerY2;
-    px2[i] = ((r - 14) * cos(DEG2RAD * i)) + centerX2; // pick marks
-    py2[i] = ((r - 14) * sin(DEG2RAD * i)) + centerY2;
-    lx2[i] = ((r - 24) * cos(DEG2RAD * i)) + centerX2; // line ends
-    ly2[i] = ((r - 24) * sin(DEG2RAD * i)) + centerY2;
+  if (!gaugeFrames.begin(TFT_WIDTH, GAUGE_STRIP_H, GAUGE_BPP, gaugePalette))
+  {
+    logE(UI, "no RAM for the gauge strip");
+  }
+  for (uint8_t i = 0; i < gaugeFrames.count(); i++)
+  {
+    TFT_eSprite &gauge = gaugeFrames.sprite(i);
+    gauge.setSwapBytes(true);
+    gauge.setTextDatum(4);
+    gauge.setTextColor(gaugeInk(TFT_WHITE), gaugeInk(backColor));
+  }
+  logI(UI, "gauge strips: %u of %u rows at %u bpp", gaugeFrames.count(), GAUGE_STRIP_H, GAUGE_BPP);
+#if TASKS != 2
+  gaugeFrames.initDma(); // TASKS 2: on the display core, see displayTask()
+#endif
 
-    if (i % 36 == 0)
-    {
-      modStart[c] = i;
-      c++;
-    }
+  logT(UI, "gauges create");
+}
 
+// Place the scale marks of a dial turned to angle degrees
+void gaugeMarksAt(GaugeMarks &m, int cx, int cy, int angle)
+{
+  for (int i = 0; i < 60; i++)
+  {
+    int deg = ((i * 6 + angle) % 360 + 360) % 360;
+    float c = cos(DEG2RAD * deg);
+    float s = sin(DEG2RAD * deg);
+    m.px[i] = ((r - 14) * c) + cx;
+    m.py[i] = ((r - 14) * s) + cy;
     if (i % 6 == 0)
     {
-      modStartP[c2] = i;
-      c2++;
+      m.tx[i / 6] = (r * c) + cx;
+      m.ty[i / 6] = (r * s) + cy;
+      m.lx[i / 6] = ((r - 24) * c) + cx;
+      m.ly[i / 6] = ((r - 24) * s) + cy;
     }
   }
+}
+
+void drawGaugeMarks(TFT_eSprite &gauge, const GaugeMarks &m, String *labels)
+{
+  for (int i = 0; i < 10; i++)
+  {
+    gauge.drawString(labels[i], m.tx[i], m.ty[i]);
+    gauge.drawLine(m.px[i * 6], m.py[i * 6], m.lx[i], m.ly[i], gaugeInk(color1));
+  }
 
-  debugln("Gauges Create");
+  for (int i = 0; i < 60; i++)
+  {
+    gauge.fillCircle(m.px[i], m.py[i], 1, gaugeInk(color3));
+  }
 }
 
-void displayGaugeData()
+// The orange pointer over a dial, from its tip to its round end.  The wedge
+// line is anti-aliased by blending with what it reads back, which a 4 bpp strip
+// can only hold as palette colours, so there the pointer is drawn solid.
+void gaugePointer(TFT_eSprite &gauge, int x, int tipY, int endY)
 {
+#if GAUGE_BPP == 4
+  gauge.fillTriangle(x - 6, endY, x + 6, endY, x, tipY, gaugeInk(TFT_ORANGE));
+  gauge.fillCircle(x, endY, 6, gaugeInk(TFT_ORANGE));
+#else
+  gauge.drawWedgeLine(x, tipY, x, endY, 1, 6, TFT_ORANGE);
+#endif
+}
 
+// Everything on the gauge, in panel coordinates: a strip's viewport keeps
+// what lands in its rows
+void drawGauge(TFT_eSprite &gauge)
+{
   // Text info
-  if (currentO2 != prevO2)
+  if (currentO2 > 20 and currentO2 < 22)
   {
-    if (currentO2 > 20 and currentO2 < 22)
-    {
-      gauge.setTextColor(TFT_CYAN, color5);
-    }
-    if (currentO2 <= 20)
-    {
-      gauge.setTextColor(TFT_YELLOW, color5);
-    }
-    if (currentO2 <= 18)
-    {
-      gauge.setTextColor(TFT_RED, color5);
-    }
-    if (currentO2 >= 22)
-    {
-      gauge.setTextColor(TFT_GREEN, color5);
-    }
+    gauge.setTextColor(gaugeInk(TFT_CYAN), gaugeInk(color5));
+  }
+  if (currentO2 <= 20)
+  {
+    gauge.setTextColor(gaugeInk(TFT_YELLOW), gaugeInk(color5));
+  }
+  if (currentO2 <= 18)
+  {
+    gauge.setTextColor(gaugeInk(TFT_RED), gaugeInk(color5));
+  }
+  if (currentO2 >= 22)
+  {
+    gauge.setTextColor(gaugeInk(TFT_GREEN), gaugeInk(color5));
+  }
+#if FASTREAD == 1
+  if (predicting)
+  {
+    gauge.setTextColor(gaugeInk(TFT_SILVER), gaugeInk(color5)); // estimate, not yet measured
+  }
+#endif
+
+  // Upper Gauge
+  gauge.fillCircle(centerX, centerY, r + 20, gaugeInk(TFT_DARKCYAN));
+  gauge.fillCircle(centerX, centerY, r - 30, gaugeInk(color5));
+  gauge.setTextSize(1);
 
-    /*
-        tft.setTextSize(1 * ResFact);
-
-        if (metric == 1)  {
-          String mod14m = String(mod14msw);
-          tft.setTextColor(TFT_GREENYELLOW, TFT_BLACK);
-          tft.drawString(String(mod14m + "-m  "), TFT_WIDTH * 0.05, TFT_HEIGHT * 0.75, 2);
-          tft.setTextColor(TFT_GOLD, TFT_BLACK);
-          String mod16m = String(mod16msw);
-          tft.drawString(String(mod16m + "-m  "), TFT_WIDTH * 0.7, TFT_HEIGHT * 0.75, 2);
-        }
-        else {
-          tft.setTextColor(TFT_GREENYELLOW, TFT_BLACK);
-          String mod14f = String(mod14fsw);
-          tft.drawString(String(mod14f + "-FT  "), TFT_WIDTH * 0, TFT_HEIGHT * 0.75, 2);
-          tft.setTextColor(TFT_GOLD, TFT_BLACK);
-          String mod16f = String(mod16fsw);
-          tft.drawString(String(mod16f + "-FT  "), TFT_WIDTH * 0.6, TFT_HEIGHT * 0.75, 2);
-        }
-    */
-    // Draw gauge with needle
-    gauge.fillSprite(TFT_BLACK);
-
-    // Upper Gauge
-    gauge.fillCircle(centerX, centerY, r + 20, TFT_DARKCYAN);
-    gauge.fillCircle(centerX, centerY, r - 30, color5);
-    gauge.setTextSize(1);
-
-    // Lower Gauge
-    gauge.fillCircle(centerX2, centerY2, r + 20, TFT_DARKGREEN);
-    gauge.fillCircle(centerX2, centerY2, r - 30, color5);
-    gauge.setTextSize(1);
+  // Lower Gauge
+  gauge.fillCircle(centerX2, centerY2, r + 20, gaugeInk(TFT_DARKGREEN));
+  gauge.fillCircle(centerX2, centerY2, r - 30, gaugeInk(color5));
+  gauge.setTextSize(1);
+
+  // Upper Gauge value
+  String ox = String(currentO2, 1);
+  gauge.drawCentreString(ox, centerX, centerY + 90, 6);
+  if (stable)
+  {
+    gauge.setTextColor(gaugeInk(TFT_GREEN), gaugeInk(color5));
+    gauge.drawCentreString("STABLE", centerX, centerY + 141, 2);
+  }
 
+  // Lower Gauge value
+  if (currentO2 > 14)
+  {
+    String modx = String(mod14fsw);
+    String modc = String(mod16fsw);
+    gauge.setTextColor(gaugeInk(TFT_GREENYELLOW), gaugeInk(color5));
+    gauge.drawCentreString(modx, centerX2, centerY2 - 140, 6);
+    gauge.setTextColor(gaugeInk(TFT_ORANGE), gaugeInk(TFT_BLACK));
+    gauge.setTextSize(2);
+    gauge.drawCentreString(modc, centerX2 + 95, centerY2 - 217, 2);
+  }
+
+  // Draw Upper Gauge Markings
+  gauge.setTextColor(gaugeInk(TFT_WHITE), gaugeInk(TFT_DARKCYAN));
+  gauge.setTextSize(2);
+  gaugePointer(gauge, centerX, centerY + 170, centerY + 155);
+  drawGaugeMarks(gauge, o2Marks, o2);
+
+  // Draw Lower Gauge Markings
+  gauge.setTextColor(gaugeInk(TFT_WHITE), gaugeInk(TFT_DARKCYAN));
+  gauge.setTextSize(2);
+  gaugePointer(gauge, centerX2, centerY2 - 170, centerY2 - 155);
+  drawGaugeMarks(gauge, modMarks, mod);
+
+#if statinfo != 0
+  displayUtilData(gauge);
+#endif
+}
+
+// Redraw the gauge when something it shows changed, a dmUpdate() mask.  It goes
+// out a strip at a time: each strip is drawn while the one before streams out.
+void displayGaugeData(uint8_t changed)
+{
+  if (changed & GAUGE_CHANGES)
+  {
     // Upper Gauge value
     o2Angle = (360 - ((currentO2)*3.6));
 
@@ -704,22 +969,10 @@ void displayGaugeData()
     if (uprAngle < 0)
       o2OffAgl = o2OffAgl + 360;
 
-    String ox = String(currentO2, 1);
-    gauge.drawCentreString(ox, centerX, centerY + 90, 6);
-    // debugln(uprAngle);
-    // debugln(o2Angle);
-
     // Lower Gauge value
     if (currentO2 > 14)
     {
       modAngle = (360 - ((mod14fsw)*1.2));
-      String modx = String(mod14fsw);
-      String modc = String(mod16fsw);
-      gauge.setTextColor(TFT_GREENYELLOW, color5);
-      gauge.drawCentreString(modx, centerX2, centerY2 - 140, 6);
-      gauge.setTextColor(TFT_ORANGE, TFT_BLACK);
-      gauge.setTextSize(2);
-      gauge.drawCentreString(modc, centerX2 + 95, centerY2 - 217, 2);
     }
 
     lwrAngle = nearbyint(modAngle) + modOffAgl;
@@ -730,100 +983,389 @@ void displayGaugeData()
     if (lwrAngle < 0)
       modOffAgl = modOffAgl + 360;
 
-    // debugln(lwrAngle);
-    // debugln(modAngle);
-
-    // Draw Upper Gauge Markings
-    gauge.setTextColor(TFT_WHITE, TFT_DARKCYAN);
-    gauge.setTextSize(2);
-    gauge.drawWedgeLine(centerX, centerY + 170, centerX, centerY + 155, 1, 6, TFT_ORANGE);
+    gaugeMarksAt(o2Marks, centerX, centerY, uprAngle);
+    gaugeMarksAt(modMarks, centerX2, centerY2, lwrAngle);
 
-    for (int i = 0; i < 10; i++)
+    for (int16_t top = 0; top < GAUGE_H; top += GAUGE_STRIP_H)
     {
-      if (o2Start[i] + uprAngle < 360)
-      {
-        gauge.drawString(o2[i], x[o2Start[i] + uprAngle], y[o2Start[i] + uprAngle]);
-        gauge.drawLine(px[o2Start[i] + uprAngle], py[o2Start[i] + uprAngle], lx[o2Start[i] + uprAngle], ly[o2Start[i] + uprAngle], color1);
-      }
-      else
-      {
-        gauge.drawString(o2[i], x[(o2Start[i] + uprAngle) - 360], y[(o2Start[i] + uprAngle) - 360]);
-        gauge.drawLine(px[(o2Start[i] + uprAngle) - 360], py[(o2Start[i] + uprAngle) - 360], lx[(o2Start[i] + uprAngle) - 360], ly[(o2Start[i] + uprAngle) - 360], color1);
-      }
+      TFT_eSprite &gauge = gaugeFrames.draw(); // the other one may still be streaming out
+      profStart(layout);
+      gauge.setViewport(0, -top, TFT_WIDTH, GAUGE_H); // gauge row top lands on strip row 0
+      gauge.fillSprite(gaugeInk(TFT_BLACK));
+      drawGauge(gauge);
+      profStop(layout);
+
+      profStart(push);
+      gaugeFrames.push(0, spFactor + top);
+      profStop(push);
     }
+  }
+
+}
+#endif
+
+// Turn the newest filtered sample into a complete reading (O2, MOD and the stats)
+// and queue a telemetry record for it.  Touches no display state, so it can run on
+// the acquisition core.
+void processStage(const Sample &sample, Reading &rd)
+{
+  static AdsState adcLogged = ADS_READY;
+  static uint32_t adcLoggedMs = 0;
+  if (adc.state != ADS_READY && (adc.state != adcLogged || (millis() - adcLoggedMs) >= ADC_WARN_MS))
+  {
+    logW(ADC, "recovering, bus errors: %lu", (unsigned long)adc.busErrors);
+    adcLoggedMs = millis();
+  }
+  adcLogged = adc.state;
+
+  profStart(gasmath);
+  bool settled = pipelineProcess(pipe, sample.filtered, batteryV, sysClock.millis(), rd);
+  profStop(gasmath);
+  rd.adcFault = (adc.state == ADS_DOWN);
+  if (settled)
+  {
+    logI(STAB, "stable after ms: %lu mean ms: %lu", (unsigned long)pipe.stability.lastTimeMs,
+         (unsigned long)stabMeanTime(pipe.stability));
+  }
+
+  msgid++;
+  TelemetryRecord rec;
+  rec.msgid = msgid;
+  rec.ms = millis();
+  rec.raw = sample.raw;
+  rec.adc = rd.ave;
+  rec.mV = rd.mV;
+  rec.batV = rd.batV;
+  rec.o2 = rd.o2;
+  rec.o2Measured = rd.o2Measured;
+  rec.mod14 = rd.mod14fsw;
+  rec.mod16 = rd.mod16fsw;
+  rec.stable = rd.stable;
+  telemetryQueue.push(rec); // dropped rather than wait when the drain falls behind
+}
+
+// Take over a reading as the display state and redraw
+void renderStage(const Reading &rd)
+{
+#if BENCH == 1
+  uint32_t frameStart = micros();
+#endif
+  FaultState was = ui.fault;
+#if GUI == 1
+  if (ui.fault != FAULT_NONE)
+  {
+    gaugeFrames.wait(); // the fault screen is drawn straight on the panel
+  }
+  if (uiFaultActive(ui, sysClock.millis()))
+  {
+    return; // fault screen stays up
+  }
+  ui.redraw = false; // the display model was reset with the fault screen
+
+  // Record old and new values, as shown: at display precision (display_model.h)
+  uint8_t changed = dmUpdate(ui.model, rd);
+  prevaveSensorValue = aveSensorValue;
+  aveSensorValue = rd.ave;
+  currentO2 = dmO2(ui.model);
+  mVolts = dmMv(ui.model);
+  batVolts = dmBatV(ui.model);
+  mod14fsw = ui.model.mod14fsw;
+  mod14msw = ui.model.mod14msw;
+  mod16fsw = ui.model.mod16fsw;
+  mod16msw = ui.model.mod16msw;
+  stable = ui.model.stable;
+  predicting = ui.model.predicting;
+  if (rd.adcFault)
+  {
+    gaugeFrames.wait();
+    uiAdcFault(ui, sysClock.millis());
+  }
+#if statinfo != 0
+  gaugeFaults();
+#endif
+  if (ui.fault == FAULT_NONE)
+  {
+    displayGaugeData(changed); // Graphic Layout
+  }
+#else
+  profStart(layout);
+  uiRender(ui, rd, sysClock.millis()); // Text Layout
+  profStop(layout);
+#endif
+#if BENCH == 1
+  benchAdd(benchFrame, micros() - frameStart);
+  if (benchBoot.n == 0)
+  {
+    benchAdd(benchBoot, millis()); // first reading on screen
+  }
+#endif
+
+  if (was == FAULT_NONE && ui.fault == FAULT_SENSOR)
+  {
+    logW(UI, "low mV reading from sensor");
+  }
+  if (was == FAULT_NONE && ui.fault == FAULT_BATTERY)
+  {
+    logW(UI, "low V reading from battery");
+  }
+  if (was == FAULT_NONE && ui.fault == FAULT_ADC)
+  {
+    logE(ADC, "no conversions, fault screen up");
+  }
+}
+
+// Telemetry stage: send the queued records.  Binary frames are only written while
+// the UART buffer can take a whole one, so this never waits on Serial; records
+// that do not fit stay queued for the next run.
+void telemetryStage()
+{
+  TelemetryRecord rec;
+#if TELEMETRY == 2
+  while (Serial.availableForWrite() >= TLM_FRAME_MAX && telemetryQueue.pop(rec))
+  {
+    profStart(debug);
+    uint8_t frame[TLM_FRAME_MAX];
+    Serial.write(frame, telemetryFrame(rec, frame));
+    profStop(debug);
+  }
+#elif TELEMETRY == 1
+  while (telemetryQueue.pop(rec))
+  {
+    profStart(debug);
+    // One tab separated line a record
+    Serial.print("Msg_ID:");
+    Serial.print(rec.msgid);
+    Serial.print("\t");
+    Serial.print("ADC:");
+    Serial.print(rec.adc);
+    Serial.print("\t");
+    Serial.print("Sensor_mV:");
+    Serial.print(rec.mV);
+    Serial.print("\t");
+    Serial.print("Batt_V:");
+    Serial.print(rec.batV);
+    Serial.print("\t");
+    Serial.print("O2:");
+    Serial.print(rec.o2);
+    Serial.print("\t");
+#if FASTREAD == 1
+    Serial.print("Measured_O2:");
+    Serial.print(rec.o2Measured);
+    Serial.print("\t");
+#endif
+    Serial.print("MOD 1.4:");
+    Serial.print(rec.mod14);
+    Serial.print("\t");
+    Serial.print("MOD 1.6:");
+    Serial.print(rec.mod16);
+    Serial.print("\t");
+    Serial.print("Stable:");
+    Serial.println(rec.stable);
+    profStop(debug);
+  }
+#else
+  while (telemetryQueue.pop(rec))
+  {
+  }
+#endif
+#if CAPTURE != 0
+  captureStage();
+#endif
+#if DEBUG == 1
+  commandStage();
+#endif
+}
 
-    for (int i = 0; i < 60; i++)
+#if TASKS == 2
+// Acquisition core: every conversion is filtered, a reading is published per frame
+void acquisitionTask(void *arg)
+{
+  uint32_t published = millis();
+  for (;;)
+  {
+    sampleStage();
+    if ((millis() - published) >= FRAME_MS)
     {
-      if (o2StartP[i] + uprAngle < 360)
-      {
-        gauge.fillCircle(px[o2StartP[i] + uprAngle], py[o2StartP[i] + uprAngle], 1, color3);
-      }
-      else
+      published = millis();
+      Sample latest;
+      Reading rd;
+      if (sampleQueue.latest(latest))
       {
-        gauge.fillCircle(px[(o2StartP[i] + uprAngle) - 360], py[(o2StartP[i] + uprAngle) - 360], 1, color3);
+        processStage(latest, rd);
+        readingBuffer.write(rd);
       }
     }
+  }
+}
 
-    // Draw Lower Gauge Markings
-    gauge.setTextColor(TFT_WHITE, TFT_DARKCYAN);
-    gauge.setTextSize(2);
-    gauge.drawWedgeLine(centerX2, centerY2 - 170, centerX2, centerY2 - 155, 1, 6, TFT_ORANGE);
-
-    for (int i = 0; i < 10; i++)
+// Display core: composites and pushes the newest published reading once per frame
+void displayTask(void *arg)
+{
+#if GUI == 1
+  gaugeFrames.initDma(); // DMA completion interrupt belongs to this core
+#endif
+  uint32_t seen = 0;
+  TickType_t wake = xTaskGetTickCount();
+  for (;;)
+  {
+    Reading rd;
+#if BENCH == 1
+    uint32_t passStart = micros();
+#endif
+    if (readingBuffer.read(rd, seen))
     {
-      if (modStart[i] + lwrAngle < 360)
-      {
-        gauge.drawString(mod[i], x2[modStart[i] + lwrAngle], y2[modStart[i] + lwrAngle]);
-        gauge.drawLine(px2[modStart[i] + lwrAngle], py2[modStart[i] + lwrAngle], lx2[modStart[i] + lwrAngle], ly2[modStart[i] + lwrAngle], color1);
-      }
-      else
-      {
-        gauge.drawString(mod[i], x2[(modStart[i] + lwrAngle) - 360], y2[(modStart[i] + lwrAngle) - 360]);
-        gauge.drawLine(px2[(modStart[i] + lwrAngle) - 360], py2[(modStart[i] + lwrAngle) - 360], lx2[(modStart[i] + lwrAngle) - 360], ly2[(modStart[i] + lwrAngle) - 360], color1);
-      }
+      renderStage(rd);
+#if BENCH == 1
+      benchAdd(benchLoop, micros() - passStart);
+#endif
     }
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(FRAME_MS));
+  }
+}
+#elif TASKS == 1
+// Highest priority: woken by ALERT/RDY (or the data rate timer), never waits on SPI
+void samplingTask(void *arg)
+{
+  for (;;)
+  {
+    sampleStage();
+  }
+}
 
-    for (int i = 0; i < 60; i++)
+// Renders the newest sample once per frame, skips frames with nothing new
+void renderTask(void *arg)
+{
+  TickType_t wake = xTaskGetTickCount();
+  for (;;)
+  {
+    Sample latest;
+    Reading rd;
+#if BENCH == 1
+    uint32_t passStart = micros();
+#endif
+    if (sampleQueue.latest(latest))
     {
-      if (modStartP[i] + lwrAngle < 360)
-      {
-        gauge.fillCircle(px2[modStartP[i] + lwrAngle], py2[modStartP[i] + lwrAngle], 1, color3);
-      }
-      else
-      {
-        gauge.fillCircle(px2[(modStartP[i] + lwrAngle) - 360], py2[(modStartP[i] + lwrAngle) - 360], 1, color3);
-      }
+      processStage(latest, rd);
+      renderStage(rd);
+#if BENCH == 1
+      benchAdd(benchLoop, micros() - passStart);
+#endif
     }
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(FRAME_MS));
+  }
+}
+#endif
 
-#if statinfo != 0
-    displayUtilData();
+#if TASKS != 0
+void telemetryTask(void *arg)
+{
+  uint32_t batteryMs = millis();
+#if BENCH == 1
+  uint32_t benchMs = millis();
+#endif
+  for (;;)
+  {
+    if ((millis() - batteryMs) >= BAT_MS)
+    {
+      batteryMs = millis();
+      batteryStage();
+    }
+#if BENCH == 1
+    if ((millis() - benchMs) >= BENCH_REPORT_MS)
+    {
+      benchMs = millis();
+      benchStage();
+    }
+#endif
+    telemetryStage();
+    vTaskDelay(pdMS_TO_TICKS(TELEMETRY_MS));
+  }
+}
 #endif
 
-    gauge.pushSprite(0, spFactor);
+#if TASKS == 0
+// Scheduler jobs besides the stages themselves
+void displayJob()
+{
+  Sample latest;
+  Reading rd;
+  if (sampleQueue.latest(latest))
+  {
+    processStage(latest, rd);
+    renderStage(rd);
+  }
+}
+
+void reportJob()
+{
+  for (uint8_t i = 0; i < scheduler.count; i++)
+  {
+    const SchedJob &j = scheduler.jobs[i];
+    logI(SCHED, "%s runs:%lu overruns:%lu max_us:%lu", j.name, (unsigned long)j.runs, (unsigned long)j.overruns,
+         (unsigned long)j.maxUs);
   }
+}
 
+uint32_t clockUs()
+{
+  return micros();
+}
+
+// One loop() pass: run jobs until none is due, at most one run per job in the
+// table so an overloaded table still returns.  Returns the ms to sleep.
+uint32_t schedPass()
+{
+  uint32_t idle = 0;
+  for (uint8_t i = 0; i < scheduler.count && idle == 0; i++)
+  {
+    idle = schedRun(scheduler, millis());
+  }
+  return idle;
+}
+
+// Nothing due: sleep until the next release
+void idleFor(uint32_t ms)
+{
+  if (ms == 0)
+  {
+    return;
+  }
+#if defined(ARDUINO_ARCH_SAMD)
+  uint32_t until = millis() + ms;
+  while ((int32_t)(millis() - until) < 0)
+  {
+    __WFI(); // woken by the 1 ms SysTick
+  }
+#else
+  delay(ms); // idle task, light sleep when power management allows
+#endif
 }
 #endif
 
 void setup()
 {
 
-  Serial.begin(115200);
+#if defined(ESP32) && !(ARDUINO_USB_CDC_ON_BOOT && !ARDUINO_USB_MODE)
+  Serial.setTxBufferSize(TELEMETRY_TX_BUF); // before begin(), not on the S3's TinyUSB CDC
+#endif
+  Serial.begin(SERIAL_BAUD);
+  logConfig().sink = logSerial;
+  logConfig().clockMs = logClock;
   // Call our validation to output the message (could be to screen / web page etc)
   printVersionToSerial();
 
-  pinMode(buttonPin, INPUT);
-  debugln("Pinmode Init");
+  button.begin();
+  logT(SYS, "pinmode init");
 
   // setup TFT
   tft.init();
-  debugln("TFT Init");
+  logT(SYS, "TFT init");
   
   // tft.invertDisplay(1);
   tft.setRotation(LCDROT);
   tft.fillScreen(TFT_BLACK);
 
-  debugln("Display Initialized");
+  logT(SYS, "display initialized");
 
   tft.fillScreen(TFT_BLACK);
   testfillcircles(5, TFT_BLUE);
@@ -847,11 +1389,31 @@ void setup()
   tft.fillScreen(TFT_BLACK);
 
   // setup display and calibrate unit
-  initADC();
-  debugln("Post ADS check statement");
+  pipelineSetMultiplier(pipe, initADC());
+  pipe.fastRead = (FASTREAD == 1);
+  samplerStart(sampler, adc);
+  logT(SYS, "post ADS check");
+#if CAPTURE != 0
+  captureBegin();
+#endif
 
-  o2calibration();
-  debugln("Post O2 calibration");
+#if BENCH == 1
+  uint32_t calStart = millis();
+#endif
+#if defined(ESP32)
+  calStoreBegin();
+  if (!warmStart())
+#endif
+  {
+    while (!o2calibration())
+    {
+      CalFault();
+    }
+  }
+#if BENCH == 1
+  benchAdd(benchCal, millis() - calStart);
+#endif
+  logT(SYS, "post O2 calibration");
 
 #if RODA == 1
   safetyrule();
@@ -862,15 +1424,57 @@ void setup()
   spFactor = 0;
 #endif
 
+  ui.d = &tftSurface;
+  ui.cfg.width = TFT_WIDTH;
+  ui.cfg.height = TFT_HEIGHT;
+  ui.cfg.resFact = ResFact;
+  ui.cfg.showMod = (MOD == 1);
+  ui.cfg.metricMod = (metric == 1);
+  ui.cfg.showNerds = (nerds == 1 and GUI == 0);
+  ui.cfg.showStats = (statinfo != 0);
+  ui.cfg.showBattery = battery.present();
+  ui.cfg.tbFactor = tbFactor;
+  ui.cfg.version = VERSION;
+
 #if GUI == 1
   gaugeBaseLayout(); // Graphic Layout
 #else
-  debugln("PRE Text Based layout");
-  textBaseLayout();  // Text Layout
-  debugln("POST Text Based layout");
+  logT(SYS, "pre text based layout");
+  uiBaseLayout(ui);  // Text Layout
+  logT(SYS, "post text based layout");
 #endif
 
-  debugln("Setup Complete Starting Loop");
+  batteryStage();
+#if CAPTURE != 0
+  captureDirect = false; // from here on the telemetry stage writes the capture
+#endif
+
+#if TASKS == 2
+  xTaskCreatePinnedToCore(acquisitionTask, "acquisition", 4096, NULL, SAMPLING_PRIO, NULL, SAMPLING_CORE);
+  xTaskCreatePinnedToCore(displayTask, "display", 8192, NULL, RENDER_PRIO, NULL, RENDER_CORE);
+  xTaskCreate(telemetryTask, "telemetry", 4096, NULL, TELEMETRY_PRIO, NULL);
+  logI(SYS, "setup complete, starting pipeline");
+#elif TASKS == 1
+  xTaskCreate(samplingTask, "sampling", 4096, NULL, SAMPLING_PRIO, NULL);
+  xTaskCreate(renderTask, "render", 8192, NULL, RENDER_PRIO, NULL);
+  xTaskCreate(telemetryTask, "telemetry", 4096, NULL, TELEMETRY_PRIO, NULL);
+  logI(SYS, "setup complete, starting tasks");
+#else
+  uint32_t now = millis();
+  uint32_t samplePeriod = max(1UL, (unsigned long)(sampler.periodUs / 2000)); // twice the conversion rate
+  scheduler.clockUs = clockUs;
+  schedAdd(scheduler, "sample", sampleDrain, samplePeriod, 2 * samplePeriod, now);
+  schedAdd(scheduler, "display", displayJob, FRAME_MS, FRAME_MS, now);
+  schedAdd(scheduler, "battery", batteryStage, BAT_MS, 100, now);
+  schedAdd(scheduler, "telemetry", telemetryStage, TELEMETRY_MS, TELEMETRY_MS, now);
+#if DEBUG == 1
+  schedAdd(scheduler, "report", reportJob, REPORT_MS, 1000, now + REPORT_MS);
+#endif
+#if BENCH == 1
+  schedAdd(scheduler, "bench", benchStage, BENCH_REPORT_MS, 1000, now + BENCH_REPORT_MS);
+#endif
+  logI(SYS, "setup complete, starting loop");
+#endif
 
 }
 
@@ -878,7 +1482,6 @@ void setup()
 void loop()
 {
 
-  multiplier = initADC();
   /* debugln("Button Check");
 
   int bstate = digitalRead(buttonPin);
@@ -903,73 +1506,17 @@ void loop()
   }
 
 */
-  // get running average value from ADC input Pin
-  RA.clear();
-  for (int x = 0; x <= RA_SIZE; x++)
-  {
-    int sensorValue = 0;
-    sensorValue = abs(ads.readADC_Differential_0_1());
-    RA.addValue(sensorValue);
-    delay(8); // was 16
-    // debugln(sensorValue);    //mV serial print for debugging
-  }
-
-  delay(100); // slowing down loop a bit
-
-  // Record old and new ADC values
-  prevaveSensorValue = aveSensorValue;
-  prevO2 = currentO2;
-  aveSensorValue = RA.getAverage();
-
-  currentO2 = (aveSensorValue * calFactor); // Units: pct
-
-  // currentO2 = currentO2 + 5; // Test Values
-
-  if (currentO2 > 99.9)
-    currentO2 = 99.9;
-
-  mVolts = (aveSensorValue * multiplier); // Units: mV
-
-#ifdef ESP32
-    batVolts = (batStat() / 1000) * BAT_ADJ; // Battery Check ESP based boards
-#endif
-
-  mod14fsw = floor(33 * ((modppo / (currentO2 / 100)) - 1));
-  mod14msw = floor(10 * ((modppo / (currentO2 / 100)) - 1));
-  mod16fsw = floor(33 * ((mod16ppo / (currentO2 / 100)) - 1));
-  mod16msw = floor(10 * ((mod16ppo / (currentO2 / 100)) - 1));
-
-  // DEBUG print out the value you read:
-  msgid++;
-  debug("Msg_ID:");
-  debug(msgid);
-  debug("\t");
-  debug("ADC:");
-  debug(aveSensorValue);
-  debug("\t");
-  debug("Sensor_mV:");
-  debug(mVolts);
-  debug("\t");
-  debug("Batt_V:");
-  debug(batVolts);
-  debug("\t");
-  debug("O2:");
-  debug(currentO2);
-  debug("\t");
-  debug("MOD 1.4:");
-  debug(mod14fsw);
-  debug("\t");
-  debug("MOD 1.6:");
-  debugln(mod16fsw);
-
-#if statinfo != 0
-  textBaseLayout();
-  displayUtilData();
-#endif
-
-#if GUI == 1
-  displayGaugeData(); // Graphic Layout
+#if TASKS != 0
+  vTaskDelete(NULL); // the stages run in the tasks started by setup()
+#else
+  // run every job that is due, sleep until the next release
+#if BENCH == 1
+  uint32_t passStart = micros();
+  uint32_t idle = schedPass();
+  benchAdd(benchLoop, micros() - passStart);
+  idleFor(idle);
 #else
-  displayTextData(); // Text Layout
+  idleFor(schedPass());
+#endif
 #endif
 }
\ No newline at end of file
@@ -0,0 +1,417 @@
+/*****************************************************************************
+
+  EANx analyser on the host
+
+  Runs the firmware's acquisition, calibration, reading pipeline and text UI
+  against the simulated HAL (include/hal/hal_sim.h) in virtual time, with the
+  galvanic cell model of include/hal/sim_sensor.h on the ADC, or a capture from
+  a unit (capture.h) replayed at its recorded times.  Prints one CSV line per
+  displayed frame, then the time to STABLE and the error for each gas step (the
+  readings at STABLE for a replay), and can write the last screen as a PPM image.
+  With -b it prints the bench.h JSON report instead of the CSV: the hot paths
+  timed on the host clock in ns, calibration and first reading in virtual ms.
+  With -D it only decodes a binary telemetry log (telemetry.h) from a unit to CSV.
+
+    pio run -e native
+    .pio/build/native/program [options]
+
+      -D file      decode binary telemetry from a file or serial device ("-" for stdin) to CSV
+      -R file      replay a capture instead of simulating the cell
+      -w file      write the conversions of the run as a capture
+      -s seconds   length of the run (60, a replay runs to its end)
+      -g o2pct     gas of the default script, air -> gas -> air (32)
+      -t step_s    when the gas is switched (10)
+      -r back_s    when it is switched back to air (35)
+      -S script    own script instead, "s:o2[:degC],..." e.g. "0:20.9,10:32:30,40:20.9"
+      -T t90_s     cell response time (6)
+      -m mv        cell output in air (10)
+      -n mv        white noise, mV rms (0.02)
+      -p mv        1/f noise, mV rms (0.01)
+      -d pct_h     sensitivity drift, % per hour (0)
+      -c pct_degc  temperature coefficient, % per deg C (0)
+      -G pga       ADS1115 gain 0-5, GAIN_TWOTHIRDS to GAIN_SIXTEEN (2)
+      -f           fastRead
+      -o file      write the last screen as a PPM image
+      -b           benchmark report instead of the CSV
+
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+#include "capture.h"
+#include "telemetry.h"
+#include "bench.h"
+#include "hal/sim_sensor.h"
+#include "filter_chain.h"
+#include "cal_engine.h"
+#include "pipeline.h"
+#include "text_ui.h"
+
+#define FRAME_MS 33       // render period, as on target
+#define SIM_SPS 250       // ADS1115 data rate
+
+static void usage()
+{
+  fprintf(stderr, "usage: program [-D telemetry] [-R capture] [-w capture] [-s seconds] [-g o2pct] [-t step_s] [-r back_s] [-S script] [-T t90_s]\n"
+                  "                      [-m mv] [-n mv] [-p mv] [-d pct_h] [-c pct_degc] [-G pga] [-f] [-o screen.ppm] [-b]\n");
+  exit(2);
+}
+
+// "s:o2[:degC],..."
+static bool parseScript(const char *arg, std::vector<GasStep> &steps)
+{
+  steps.clear();
+  while (*arg)
+  {
+    GasStep st = {0, 0, 25};
+    int used = 0;
+    int n = sscanf(arg, "%f:%f%n:%f%n", &st.atS, &st.o2Pct, &used, &st.tempC, &used);
+    if (n < 2 || (!steps.empty() && st.atS < steps.back().atS))
+    {
+      return false;
+    }
+    steps.push_back(st);
+    arg += used;
+    if (*arg == ',')
+    {
+      arg++;
+    }
+    else if (*arg)
+    {
+      return false;
+    }
+  }
+  return !steps.empty();
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f)
+  {
+    return false;
+  }
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+  {
+    data.insert(data.end(), buf, buf + n);
+  }
+  fclose(f);
+  return true;
+}
+
+static uint32_t hostNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static void benchOut(const char *s)
+{
+  fputs(s, stdout);
+}
+
+// Binary telemetry to CSV, a line per record as it arrives
+static int decodeTelemetry(const char *path)
+{
+  FILE *f = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+  if (!f)
+  {
+    fprintf(stderr, "cannot read %s\n", path);
+    return 1;
+  }
+  TelemetryDecoder d;
+  TelemetryRecord r;
+  int c;
+  printf("msgid,ms,raw,adc,mV,batV,o2,o2_measured,mod14,mod16,stable\n");
+  while ((c = getc(f)) != EOF)
+  {
+    if (telemetryFeed(d, c, r))
+    {
+      printf("%u,%u,%d,%.2f,%.3f,%.3f,%.2f,%.2f,%d,%d,%d\n", r.msgid, r.ms, r.raw, r.adc, r.mV, r.batV, r.o2,
+             r.o2Measured, r.mod14, r.mod16, r.stable);
+      fflush(stdout);
+    }
+  }
+  fprintf(stderr, "%u records, %u other blocks\n", d.good, d.bad);
+  return 0;
+}
+
+static FILE *captureFile = nullptr;
+
+static void captureEmit(const CaptureChunk &c)
+{
+  fwrite(c.data, 1, c.len, captureFile);
+}
+
+// Per scripted step: from the switch to the first STABLE, and the error then and at the end
+struct StepResult
+{
+  uint32_t atMs;
+  float gas;
+  int32_t stableMs = -1;
+  float stableErr = 0;
+  float endErr = 0;
+};
+
+int main(int argc, char **argv)
+{
+  float seconds = -1;
+  float gasO2 = 32;    // % O2 of the gas switched to
+  float stepS = 10;    // when the gas is switched
+  float backS = 35;    // and back to air
+  float airMv = 10;
+  bool fastRead = false;
+  const char *ppm = nullptr;
+  const char *script = nullptr;
+  const char *replay = nullptr;
+  const char *record = nullptr;
+  bool bench = false;
+  SensorModel model;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "D:R:w:s:g:t:r:S:T:m:n:p:d:c:G:fo:b")) != -1)
+  {
+    switch (opt)
+    {
+    case 'D': return decodeTelemetry(optarg);
+    case 'R': replay = optarg; break;
+    case 'w': record = optarg; break;
+    case 's': seconds = atof(optarg); break;
+    case 'g': gasO2 = atof(optarg); break;
+    case 't': stepS = atof(optarg); break;
+    case 'r': backS = atof(optarg); break;
+    case 'S': script = optarg; break;
+    case 'T': model.t90S = atof(optarg); break;
+    case 'm': airMv = atof(optarg); break;
+    case 'n': model.whiteMv = atof(optarg); break;
+    case 'p': model.pinkMv = atof(optarg); break;
+    case 'd': model.driftPctH = atof(optarg); break;
+    case 'c': model.tempCoPct = atof(optarg); break;
+    case 'G': model.pga = atoi(optarg); break;
+    case 'f': fastRead = true; break;
+    case 'o': ppm = optarg; break;
+    case 'b': bench = true; break;
+    default: usage();
+    }
+  }
+  model.mvPerPct = airMv / O2_AIR;
+
+  std::vector<GasStep> steps;
+  if (script)
+  {
+    if (!parseScript(script, steps))
+    {
+      usage();
+    }
+  }
+  else
+  {
+    steps.push_back(GasStep{0, O2_AIR, 25});
+    steps.push_back(GasStep{stepS, gasO2, 25});
+    steps.push_back(GasStep{backS, O2_AIR, 25});
+  }
+
+  SimClock clock;
+  SimBattery battery;
+  MemorySurface screen(240, 240);
+
+  // The conversions: the cell model, or a capture
+  SimO2Sensor cell(clock, SIM_SPS, model);
+  cell.setScript(steps);
+  std::vector<CaptureSample> captured;
+  CaptureReader reader;
+  if (replay)
+  {
+    std::vector<uint8_t> data;
+    if (!readFile(replay, data))
+    {
+      fprintf(stderr, "cannot read %s\n", replay);
+      return 1;
+    }
+    capDecode(reader, data.data(), data.size(), captured);
+    fprintf(stderr, "%s: %u conversions, %u chunks, %u bad, %u bytes skipped, %u SPS, %.5f mV per count\n",
+            replay, (unsigned)captured.size(), reader.chunks, reader.badCrc, reader.skipped, reader.sps,
+            reader.mvPerCount);
+    if (captured.empty())
+    {
+      return 1;
+    }
+    if (reader.mvPerCount == 0) // joined late and no header came by
+    {
+      reader.mvPerCount = simPgaMvPerCount(2);
+    }
+  }
+  ReplayAdc player(clock, captured, reader.sps, reader.mvPerCount);
+  AdcSource *source = replay ? (AdcSource *)&player : (AdcSource *)&cell;
+  if (seconds < 0)
+  {
+    seconds = replay ? 1e9 : 60;
+  }
+
+  CaptureWriter writer;
+  if (record)
+  {
+    captureFile = fopen(record, "wb");
+    if (!captureFile)
+    {
+      fprintf(stderr, "cannot write %s\n", record);
+      return 1;
+    }
+    capBegin(writer, 1000000UL / source->periodUs(), source->mvPerCount(), captureEmit);
+  }
+  CaptureAdc recorder(*source, clock, writer);
+  AdcSource &adc = record ? (AdcSource &)recorder : *source;
+
+  Pipeline pipe;
+  pipelineSetMultiplier(pipe, adc.mvPerCount());
+  pipe.fastRead = fastRead;
+
+  TextUi ui;
+  ui.d = &screen;
+  ui.cfg.version = "native";
+
+  // Calibrate in air
+  CalEngine cal;
+  calBegin(cal, clock.millis());
+  while (calAdd(cal, clock.millis(), abs(adc.next())) == CAL_RUNNING)
+  {
+  }
+  if (cal.state == CAL_FAILED)
+  {
+    fprintf(stderr, "calibration failed, drift %.3f %%/s\n", cal.driftPct);
+    return 1;
+  }
+  pipelineCalibrate(pipe, cal.sum, cal.count);
+  fprintf(stderr, "calibrated in %u ms, mean %.1f counts\n", clock.millis() - cal.startMs, calMean(cal));
+
+  // Same stats as the firmware's BENCH build
+  BenchStat benchAcquire("acquire", "ns");
+  BenchStat benchFilter("filter", "ns");
+  BenchStat benchLoop("loop", "ns");
+  BenchStat benchFrame("frame_text", "ns");
+  BenchStat benchCal("calibration", "ms");
+  BenchStat benchBoot("boot_to_reading", "ms");
+  BenchStat *const benchStats[] = {&benchAcquire, &benchFilter, &benchLoop, &benchFrame, &benchCal, &benchBoot};
+  benchAdd(benchCal, clock.millis() - cal.startMs);
+
+  FilterChain<Median<5>, Ema<2>, Window<20>> filter;
+  uint32_t start = clock.millis();
+  uint32_t nextFrame = start;
+  std::vector<StepResult> results;
+  size_t step = (size_t)-1;
+  int32_t filtered = 0;
+  int16_t raw = 0;
+  Reading rd;
+
+  screen.fillScreen(TFT_BLACK);
+  uiBaseLayout(ui);
+  if (!bench)
+  {
+    printf("ms,counts,mV,o2,o2_measured,mod14,mod16,stable,predicting\n");
+  }
+
+  while ((clock.millis() - start) < seconds * 1000 && !(replay && player.done()))
+  {
+    uint32_t t0 = hostNs();
+    raw = adc.next();
+    uint32_t t1 = hostNs();
+    filtered = filter.apply(filterIn(abs(raw)));
+    uint32_t t2 = hostNs();
+    benchAdd(benchFilter, t2 - t1);
+    benchAdd(benchAcquire, t2 - t0);
+
+    if ((int32_t)(clock.millis() - nextFrame) >= 0)
+    {
+      nextFrame += FRAME_MS;
+      t0 = hostNs();
+      bool settled = pipelineProcess(pipe, filtered, battery.volts(), clock.millis(), rd);
+      t1 = hostNs();
+      uiRender(ui, rd, clock.millis());
+      t2 = hostNs();
+      benchAdd(benchFrame, t2 - t1);
+      benchAdd(benchLoop, t2 - t0);
+      if (benchBoot.n == 0)
+      {
+        benchAdd(benchBoot, clock.millis());
+      }
+
+      if (replay)
+      {
+        if (settled)
+        {
+          fprintf(stderr, "stable at %6u ms  %5.2f %% O2  %.3f mV, %u ms after the reading moved\n",
+                  clock.millis(), rd.o2, rd.mV, pipe.stability.lastTimeMs);
+        }
+      }
+      else
+      {
+        size_t now = cell.stepAt(clock.nowUs());
+        if (now != step)
+        {
+          step = now;
+          StepResult r;
+          r.atMs = clock.millis();
+          r.gas = cell.script()[now].o2Pct;
+          results.push_back(r);
+        }
+        StepResult &r = results.back();
+        if (settled && r.stableMs < 0)
+        {
+          r.stableMs = clock.millis() - r.atMs;
+          r.stableErr = rd.o2 - r.gas;
+        }
+        r.endErr = rd.o2 - r.gas;
+      }
+
+      if (!bench)
+      {
+        printf("%u,%d,%.3f,%.2f,%.2f,%d,%d,%d,%d\n", clock.millis() - start, raw, rd.mV, rd.o2,
+               rd.o2Measured, rd.mod14fsw, rd.mod16fsw, rd.stable, rd.predicting);
+      }
+    }
+  }
+  if (bench)
+  {
+    benchReport(benchStats, sizeof(benchStats) / sizeof(benchStats[0]), "native", "host", benchOut);
+  }
+
+  if (record)
+  {
+    capFlush(writer);
+    fclose(captureFile);
+    fprintf(stderr, "captured %u conversions in %u chunks to %s\n", writer.samples, writer.chunks, record);
+  }
+  if (!replay)
+  {
+    fprintf(stderr, "conversions %llu, missed %llu\n", (unsigned long long)cell.count, (unsigned long long)cell.missed);
+  }
+  for (const StepResult &r : results)
+  {
+    if (r.stableMs < 0)
+    {
+      fprintf(stderr, "step %6u ms  %5.1f %% O2  not stable, error at end %+.2f\n", r.atMs, r.gas, r.endErr);
+    }
+    else
+    {
+      fprintf(stderr, "step %6u ms  %5.1f %% O2  stable after %5d ms, error %+.2f, at end %+.2f\n",
+              r.atMs, r.gas, r.stableMs, r.stableErr, r.endErr);
+    }
+  }
+  for (const MemorySurface::Text &t : screen.texts)
+  {
+    fprintf(stderr, "screen %3d,%3d  %s\n", t.x, t.y, t.s.c_str());
+  }
+  if (ppm && !screen.writePpm(ppm))
+  {
+    fprintf(stderr, "cannot write %s\n", ppm);
+    return 1;
+  }
+  return 0;
+}
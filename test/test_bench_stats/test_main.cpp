@@ -0,0 +1,79 @@
+/*
+ *  Host test: benchmark statistics and the JSON report line.
+ *
+ *  pio test -e native -f test_bench_stats
+ */
+
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include "bench.h"
+
+std::string report;
+
+void out(const char *s)
+{
+    report += s;
+}
+
+void setUp()
+{
+    report.clear();
+}
+
+void tearDown() {}
+
+void test_percentiles()
+{
+    BenchStat s("t", "us");
+    for (uint32_t v = 1; v <= 100; v++)
+    {
+        benchAdd(s, v);
+    }
+    BenchSummary r = benchSummary(s);
+    TEST_ASSERT_EQUAL(100, r.n);
+    TEST_ASSERT_EQUAL(51, r.mean); // 50.5 rounded
+    TEST_ASSERT_EQUAL(50, r.p50);
+    TEST_ASSERT_EQUAL(99, r.p99);
+    TEST_ASSERT_EQUAL(100, r.max);
+}
+
+// Percentiles follow the recent window, mean and max the whole run
+void test_window()
+{
+    BenchStat s("t", "us");
+    benchAdd(s, 5000);
+    for (int i = 0; i < BENCH_SAMPLES * 3; i++)
+    {
+        benchAdd(s, 10);
+    }
+    BenchSummary r = benchSummary(s);
+    TEST_ASSERT_EQUAL(10, r.p50);
+    TEST_ASSERT_EQUAL(10, r.p99);
+    TEST_ASSERT_EQUAL(5000, r.max);
+    TEST_ASSERT_EQUAL(BENCH_SAMPLES * 3 + 1, r.n);
+    TEST_ASSERT_GREATER_THAN(10, r.mean);
+}
+
+void test_report()
+{
+    BenchStat a("filter", "us");
+    BenchStat b("calibration", "ms");
+    BenchStat *const stats[] = {&a, &b};
+    benchAdd(a, 7);
+    benchAdd(b, 1234);
+    benchReport(stats, 2, "v1", "board", out);
+    TEST_ASSERT_EQUAL_STRING("{\"bench\":\"EANx\",\"version\":\"v1\",\"board\":\"board\",\"stats\":{"
+                             "\"filter\":{\"unit\":\"us\",\"n\":1,\"mean\":7,\"p50\":7,\"p99\":7,\"max\":7},"
+                             "\"calibration\":{\"unit\":\"ms\",\"n\":1,\"mean\":1234,\"p50\":1234,\"p99\":1234,\"max\":1234}}}\n",
+                             report.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_percentiles);
+    RUN_TEST(test_window);
+    RUN_TEST(test_report);
+    return UNITY_END();
+}
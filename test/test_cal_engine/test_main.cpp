@@ -0,0 +1,103 @@
+/*
+ *  Host test: the calibration engine on the simulated ADC.  A steady cell exits
+ *  early on a tight confidence interval, a cell still settling has its window
+ *  restarted, and a noisy cell or no cell at all ends in CAL_FAILED at the
+ *  timeout.
+ *
+ *  pio test -e native -f test_cal_engine
+ */
+
+#include <unity.h>
+#include <stdlib.h>
+#include <math.h>
+#include "hal/hal_sim.h"
+#include "cal_engine.h"
+
+#define AIR_MV 10.0
+#define SPS    250
+#define MV_PER_COUNT 0.0625
+
+// Cell output still rising after power up, 30% short with a 1.5 s time constant
+class SettlingAdc : public SimAdc
+{
+public:
+    SettlingAdc(SimClock &clock) : SimAdc(clock, SPS, MV_PER_COUNT) {}
+
+protected:
+    double sensorMv(uint64_t us) override { return AIR_MV * (1 - 0.3 * exp(-(us / 1e6) / 1.5)); }
+};
+
+SimClock *clk;
+
+void setUp() { clk = new SimClock; }
+void tearDown() { delete clk; }
+
+static void calibrate(CalEngine &cal, SimAdc &adc)
+{
+    calBegin(cal, clk->millis());
+    while (calAdd(cal, clk->millis(), abs(adc.next())) == CAL_RUNNING)
+    {
+    }
+}
+
+void test_steady_exits_early()
+{
+    SimAdc adc(*clk, SPS, MV_PER_COUNT);
+    adc.setMv(AIR_MV);
+    adc.setNoise(1.0);
+    CalEngine cal;
+    calibrate(cal, adc);
+    TEST_ASSERT_EQUAL(CAL_DONE, cal.state);
+    TEST_ASSERT_EQUAL(0, cal.restarts);
+    TEST_ASSERT_LESS_THAN(CAL_MIN_MS + 100, clk->millis() - cal.startMs);
+    TEST_ASSERT_LESS_THAN(CAL_CI_PCT, cal.ciPct);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, AIR_MV / MV_PER_COUNT, calMean(cal));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, AIR_MV / MV_PER_COUNT, (float)cal.sum / cal.count);
+}
+
+void test_drift_restarts_window()
+{
+    SettlingAdc adc(*clk);
+    adc.setNoise(1.0);
+    CalEngine cal;
+    calibrate(cal, adc);
+    TEST_ASSERT_EQUAL(CAL_DONE, cal.state);
+    TEST_ASSERT_GREATER_THAN(0, cal.restarts);
+    TEST_ASSERT_GREATER_THAN(CAL_WINDOW_MS, cal.windowMs - cal.startMs);
+    TEST_ASSERT_LESS_THAN(CAL_DRIFT_PCT_S, cal.driftPct);
+    TEST_ASSERT_FLOAT_WITHIN(AIR_MV / MV_PER_COUNT * 0.01, AIR_MV / MV_PER_COUNT, calMean(cal));
+}
+
+void test_noisy_times_out()
+{
+    SimAdc adc(*clk, SPS, MV_PER_COUNT);
+    adc.setMv(AIR_MV);
+    adc.setNoise(20.0);
+    CalEngine cal;
+    calibrate(cal, adc);
+    TEST_ASSERT_EQUAL(CAL_FAILED, cal.state);
+    TEST_ASSERT_UINT32_WITHIN(1000 / SPS + 1, CAL_TIMEOUT_MS, clk->millis() - cal.startMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(CAL_CI_PCT, cal.ciPct);
+}
+
+void test_no_sensor_fails()
+{
+    SimAdc adc(*clk, SPS, MV_PER_COUNT);
+    adc.setMv((CAL_MIN_COUNTS / 2) * MV_PER_COUNT);
+    adc.setNoise(0.5);
+    CalEngine cal;
+    calibrate(cal, adc);
+    TEST_ASSERT_EQUAL(CAL_FAILED, cal.state);
+    TEST_ASSERT_TRUE(isinf(cal.ciPct));
+    TEST_ASSERT_GREATER_THAN(0, cal.restarts);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_steady_exits_early);
+    RUN_TEST(test_drift_restarts_window);
+    RUN_TEST(test_noisy_times_out);
+    RUN_TEST(test_no_sensor_fails);
+    return UNITY_END();
+}
@@ -0,0 +1,125 @@
+/*
+ *  Host test: a raw ADC capture decodes back to the conversions recorded, also
+ *  with text interleaved, a corrupted chunk, a micros() wrap and a late start.
+ *
+ *  pio test -e native -f test_capture
+ */
+
+#include <unity.h>
+#include <stdlib.h>
+#include <vector>
+#include "capture.h"
+
+std::vector<uint8_t> stream;
+CaptureWriter writer;
+
+void emit(const CaptureChunk &c)
+{
+    stream.insert(stream.end(), c.data, c.data + c.len);
+}
+
+void setUp()
+{
+    stream.clear();
+    writer = CaptureWriter();
+    capBegin(writer, 250, 0.0625, emit);
+}
+
+void tearDown() {}
+
+// 250 SPS with read jitter, a slow signal with the odd spike and sign change
+static void record(std::vector<CaptureSample> &in, uint32_t startUs, int n)
+{
+    srand(3);
+    uint32_t us = startUs;
+    for (int i = 0; i < n; i++)
+    {
+        us += 4000 + (rand() % 200) - 100;
+        if (i == n / 2)
+        {
+            us += 250000; // a stalled reader
+        }
+        int16_t counts = 160 + (rand() % 7) - 3;
+        if (i % 97 == 0)
+        {
+            counts = -32768 + (rand() % 100); // rail
+        }
+        in.push_back(CaptureSample{us, counts});
+        capAdd(writer, us, counts);
+    }
+    capFlush(writer);
+}
+
+void test_round_trip()
+{
+    std::vector<CaptureSample> in, out;
+    record(in, 1000, 5000);
+    CaptureReader r;
+    capDecode(r, stream.data(), stream.size(), out);
+
+    TEST_ASSERT_EQUAL(in.size(), out.size());
+    for (size_t i = 0; i < in.size(); i++)
+    {
+        TEST_ASSERT_EQUAL(in[i].us, out[i].us);
+        TEST_ASSERT_EQUAL(in[i].counts, out[i].counts);
+    }
+    TEST_ASSERT_EQUAL(250, r.sps);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0625, r.mvPerCount);
+    TEST_ASSERT_EQUAL(0, r.badCrc);
+    TEST_ASSERT_EQUAL(0, r.skipped);
+    TEST_ASSERT_LESS_THAN(3.0 * in.size(), (float)stream.size()); // under three bytes a conversion, with this jitter
+}
+
+void test_micros_wrap()
+{
+    std::vector<CaptureSample> in, out;
+    record(in, 0xFFFFFFFFUL - 2000000, 1000);
+    CaptureReader r;
+    capDecode(r, stream.data(), stream.size(), out);
+
+    TEST_ASSERT_EQUAL(in.size(), out.size());
+    for (size_t i = 1; i < out.size(); i++)
+    {
+        TEST_ASSERT_GREATER_THAN(out[i - 1].us, (float)out[i].us);
+        TEST_ASSERT_EQUAL((uint32_t)in[i].us, (uint32_t)out[i].us);
+    }
+}
+
+// Debug text between chunks, one chunk damaged, a late start and a cut end
+void test_resync()
+{
+    std::vector<CaptureSample> in, out;
+    record(in, 1000, 2000);
+    std::vector<uint8_t> s;
+    const char text[] = "Msg_ID:12\tADC:160\tSensor_mV:10.00\r\n";
+    s.insert(s.end(), stream.begin() + 40, stream.begin() + 1000); // joined mid chunk
+    s.insert(s.end(), text, text + sizeof(text) - 1);
+    s.insert(s.end(), stream.begin() + 1000, stream.end() - 3);    // cut short
+    s[1500] ^= 0x10;
+
+    CaptureReader r;
+    capDecode(r, s.data(), s.size(), out);
+    TEST_ASSERT_GREATER_OR_EQUAL(1, r.badCrc);
+    TEST_ASSERT_GREATER_THAN(in.size() * 0.85, (float)out.size());
+
+    // Whatever decoded is exactly what was recorded
+    size_t j = 0;
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        while (j < in.size() && in[j].us != out[i].us)
+        {
+            j++;
+        }
+        TEST_ASSERT_TRUE(j < in.size());
+        TEST_ASSERT_EQUAL(in[j].counts, out[i].counts);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_micros_wrap);
+    RUN_TEST(test_resync);
+    return UNITY_END();
+}
@@ -0,0 +1,122 @@
+/*
+ *  Host test: shown values move a whole display step at a time with hysteresis,
+ *  dmUpdate() reports only the parts that changed, and with a noisy cell in a
+ *  steady gas most text mode frames send nothing to the panel.
+ *
+ *  pio test -e native -f test_display_model
+ */
+
+#include <unity.h>
+#include <stdlib.h>
+#include "hal/hal_sim.h"
+#include "filter_chain.h"
+#include "cal_engine.h"
+#include "pipeline.h"
+#include "display_model.h"
+#include "text_ui.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_quant_hysteresis()
+{
+    QuantValue v;
+    TEST_ASSERT_TRUE(quantUpdate(v, 32.04, 0.1));
+    TEST_ASSERT_EQUAL(320, v.q);
+    TEST_ASSERT_FALSE(quantUpdate(v, 32.06, 0.1)); // past the rounding point, inside the band
+    TEST_ASSERT_FALSE(quantUpdate(v, 31.94, 0.1));
+    TEST_ASSERT_TRUE(quantUpdate(v, 32.08, 0.1));
+    TEST_ASSERT_EQUAL(321, v.q);
+    TEST_ASSERT_FALSE(quantUpdate(v, 32.04, 0.1)); // and back is as sticky
+    TEST_ASSERT_TRUE(quantUpdate(v, 31.5, 0.1));   // a real step goes straight there
+    TEST_ASSERT_EQUAL(315, v.q);
+}
+
+void test_changed_parts()
+{
+    DisplayModel m;
+    Reading rd = {};
+    rd.o2 = 32.0;
+    rd.mV = 15.3;
+    rd.batV = 3.9;
+    rd.mod14fsw = 111;
+    rd.mod16fsw = 132;
+    TEST_ASSERT_EQUAL(DM_ALL, dmUpdate(m, rd));
+    TEST_ASSERT_EQUAL(0, dmUpdate(m, rd));
+
+    rd.o2 = 32.03;
+    rd.mod14fsw = 110; // rounds the other way, but goes with the O2 shown
+    TEST_ASSERT_EQUAL(0, dmUpdate(m, rd));
+    TEST_ASSERT_EQUAL(111, m.mod14fsw);
+
+    rd.o2 = 32.2;
+    TEST_ASSERT_EQUAL(DM_O2 | DM_MOD, dmUpdate(m, rd));
+    TEST_ASSERT_EQUAL(110, m.mod14fsw);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 32.2, dmO2(m));
+
+    rd.stable = true;
+    rd.batV = 3.7;
+    TEST_ASSERT_EQUAL(DM_STABLE | DM_BATTERY, dmUpdate(m, rd));
+
+    dmInvalidate(m);
+    TEST_ASSERT_EQUAL(DM_ALL, dmUpdate(m, rd));
+}
+
+// A noisy cell in air: the shown O2 settles and the frames go quiet
+void test_noisy_frames_skip_spi()
+{
+    SimClock clk;
+    SimAdc adc(clk, 250, 0.0625);
+    MemorySurface screen(240, 240);
+    Pipeline pipeline;
+    TextUi ui;
+    adc.setMv(10.0);
+    adc.setNoise(1.0);
+    pipelineSetMultiplier(pipeline, adc.mvPerCount());
+    ui.d = &screen;
+    ui.cfg.version = "test";
+
+    CalEngine cal;
+    calBegin(cal, clk.millis());
+    while (calAdd(cal, clk.millis(), abs(adc.next())) == CAL_RUNNING)
+    {
+    }
+    pipelineCalibrate(pipeline, cal.sum, cal.count);
+    uiBaseLayout(ui);
+
+    FilterChain<Median<5>, Ema<2>, Window<20>> filter;
+    Reading rd;
+    uint32_t nextFrame = clk.millis();
+    int frames = 0, quiet = 0;
+    float lo = 100, hi = 0;
+    while (clk.millis() < 40000)
+    {
+        int32_t filtered = filter.apply(filterIn(abs(adc.next())));
+        if ((int32_t)(clk.millis() - nextFrame) >= 0)
+        {
+            nextFrame += 33;
+            pipelineProcess(pipeline, filtered, 3.9, clk.millis(), rd);
+            uint64_t before = screen.pixels;
+            uiRender(ui, rd, clk.millis());
+            if (clk.millis() > 10000)
+            {
+                frames++;
+                quiet += (screen.pixels == before);
+                lo = (rd.o2 < lo) ? rd.o2 : lo;
+                hi = (rd.o2 > hi) ? rd.o2 : hi;
+            }
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(0.1, hi - lo); // the reading spans display steps
+    TEST_ASSERT_GREATER_THAN(frames * 0.9, (float)quiet);
+    TEST_ASSERT_EQUAL_STRING("20.9", screen.textNear(52)->s.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_quant_hysteresis);
+    RUN_TEST(test_changed_parts);
+    RUN_TEST(test_noisy_frames_skip_spi);
+    return UNITY_END();
+}
@@ -0,0 +1,155 @@
+/*
+ *  Host test: the double-buffered handoff.  The reader sees each publish once,
+ *  skips straight to the newest when it falls behind, and a publish that lands
+ *  while the reader is copying makes it copy again and return the newer state.
+ *  A writer and a reader on two threads check that no copy is ever torn.
+ *
+ *  pio test -e native -f test_double_buffer
+ */
+
+#include <unity.h>
+#include <thread>
+#include "double_buffer.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct State
+{
+    int32_t a;
+    int32_t b; // always -a, a torn copy would break that
+};
+
+static State state(int32_t a) { return State{a, -a}; }
+
+void test_handoff()
+{
+    DoubleBuffer<State> db;
+    uint32_t seen = 0;
+    State s = state(0);
+    TEST_ASSERT_FALSE(db.read(s, seen)); // nothing published yet
+
+    db.write(state(1));
+    TEST_ASSERT_TRUE(db.read(s, seen));
+    TEST_ASSERT_EQUAL_INT32(1, s.a);
+    TEST_ASSERT_FALSE(db.read(s, seen)); // each publish is seen once
+
+    db.write(state(2));
+    db.write(state(3));
+    db.write(state(4));
+    TEST_ASSERT_TRUE(db.read(s, seen));
+    TEST_ASSERT_EQUAL_INT32(4, s.a); // behind: the newest, not the next
+    TEST_ASSERT_EQUAL_INT32(-4, s.b);
+    TEST_ASSERT_FALSE(db.read(s, seen));
+
+    uint32_t other = 0; // a second reader keeps its own place
+    TEST_ASSERT_TRUE(db.read(s, other));
+    TEST_ASSERT_EQUAL_INT32(4, s.a);
+}
+
+// The writer cutting in on the reader's copy, once per read
+struct Racy;
+static DoubleBuffer<Racy> *racyBuf;
+static int racyLeft;
+
+struct Racy
+{
+    int32_t a = 0;
+    int32_t b = 0;
+
+    Racy() {}
+    Racy(int32_t v) : a(v), b(-v) {}
+    Racy &operator=(const Racy &o)
+    {
+        a = o.a;
+        if (racyLeft > 0)
+        {
+            racyLeft--;
+            racyBuf->write(Racy(o.a + 100)); // publish between the two halves
+        }
+        b = o.b;
+        return *this;
+    }
+};
+
+void test_republish_while_copying()
+{
+    DoubleBuffer<Racy> db;
+    racyBuf = &db;
+    uint32_t seen = 0;
+    Racy r;
+
+    racyLeft = 0;
+    db.write(Racy(1));
+    racyLeft = 1;
+    TEST_ASSERT_TRUE(db.read(r, seen));
+    TEST_ASSERT_EQUAL_INT32(101, r.a); // the first copy was dropped
+    TEST_ASSERT_EQUAL_INT32(-101, r.b);
+    TEST_ASSERT_FALSE(db.read(r, seen)); // and the newer publish marked seen
+    racyBuf = nullptr;
+}
+
+// Every word of a Reading-sized state carries the same publish number
+struct Wide
+{
+    uint32_t w[16];
+};
+
+#define STRESS_PUBLISHES 1000000
+
+void test_two_threads_never_tear()
+{
+    DoubleBuffer<Wide> *db = new DoubleBuffer<Wide>;
+    std::thread writer([db]() {
+        Wide s;
+        for (uint32_t n = 1; n <= STRESS_PUBLISHES; n++)
+        {
+            for (uint8_t i = 0; i < 16; i++)
+            {
+                s.w[i] = n;
+            }
+            db->write(s);
+            if ((n & 255) == 0)
+            {
+                std::this_thread::yield(); // let a single core host run the reader too
+            }
+        }
+    });
+
+    uint32_t seen = 0;
+    uint32_t last = 0;
+    uint32_t reads = 0;
+    uint32_t torn = 0;
+    uint32_t backwards = 0;
+    Wide s;
+    while (last < STRESS_PUBLISHES)
+    {
+        if (!db->read(s, seen))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        reads++;
+        for (uint8_t i = 1; i < 16; i++)
+        {
+            torn += (s.w[i] != s.w[0]);
+        }
+        backwards += (s.w[0] <= last);
+        last = s.w[0];
+    }
+    writer.join();
+    delete db;
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, backwards);
+    TEST_ASSERT_GREATER_THAN(100, reads); // the two really did overlap
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_handoff);
+    RUN_TEST(test_republish_while_copying);
+    RUN_TEST(test_two_threads_never_tear);
+    return UNITY_END();
+}
@@ -0,0 +1,109 @@
+/*
+ *  Host test: the filter chain stages on their own and chained.  The median
+ *  drops spikes shorter than half its length, the EMA follows a step as
+ *  1 - (1 - 1/2^SHIFT)^n and settles exactly, and the window averages the last
+ *  N samples across the wrap of its ring buffer.
+ *
+ *  pio test -e native -f test_filter_chain
+ */
+
+#include <unity.h>
+#include "filter_chain.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_median_rejects_spikes()
+{
+    Median<5> m;
+    for (int i = 0; i < 5; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32(filterIn(100), m.apply(filterIn(100)));
+    }
+    // One and two sample spikes, either way, never reach the output
+    TEST_ASSERT_EQUAL_INT32(filterIn(100), m.apply(filterIn(30000)));
+    TEST_ASSERT_EQUAL_INT32(filterIn(100), m.apply(filterIn(100)));
+    TEST_ASSERT_EQUAL_INT32(filterIn(100), m.apply(filterIn(-30000)));
+    TEST_ASSERT_EQUAL_INT32(filterIn(100), m.apply(filterIn(-30000)));
+    for (int i = 0; i < 5; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32(filterIn(100), m.apply(filterIn(100)));
+    }
+    // A real step passes once it holds the majority
+    TEST_ASSERT_EQUAL_INT32(filterIn(100), m.apply(filterIn(200)));
+    TEST_ASSERT_EQUAL_INT32(filterIn(100), m.apply(filterIn(200)));
+    TEST_ASSERT_EQUAL_INT32(filterIn(200), m.apply(filterIn(200)));
+
+    m.reset();
+    TEST_ASSERT_EQUAL_INT32(filterIn(7), m.apply(filterIn(7))); // no stale samples
+}
+
+void test_ema_step_response()
+{
+    Ema<2> e;
+    TEST_ASSERT_EQUAL_INT32(0, e.apply(0)); // primes on the first sample
+    int32_t step = filterIn(1000);
+    int32_t last = 0;
+    float expect = 0;
+    for (int n = 1; n <= 60; n++)
+    {
+        int32_t y = e.apply(step);
+        expect += (step - expect) / 4;
+        TEST_ASSERT_GREATER_OR_EQUAL(last, y);         // monotonic, no overshoot
+        TEST_ASSERT_INT_WITHIN(4, (int32_t)expect, y); // 1 - (3/4)^n within rounding
+        last = y;
+    }
+    TEST_ASSERT_EQUAL_INT32(step, last); // settles exactly, no truncation offset
+
+    e.reset();
+    TEST_ASSERT_EQUAL_INT32(filterIn(5), e.apply(filterIn(5))); // re-primes after reset
+}
+
+void test_window_wraps()
+{
+    Window<4> w;
+    TEST_ASSERT_EQUAL_INT32(filterIn(10), w.apply(filterIn(10))); // partial: mean of what is held
+    TEST_ASSERT_EQUAL_INT32(filterIn(15), w.apply(filterIn(20)));
+    w.apply(filterIn(30));
+    TEST_ASSERT_EQUAL_INT32(filterIn(25), w.apply(filterIn(40)));
+    // Past the wrap the oldest drops out and the running sum stays exact
+    for (int32_t v = 50; v <= 1000; v += 10)
+    {
+        TEST_ASSERT_EQUAL_INT32(filterIn(v - 15), w.apply(filterIn(v)));
+    }
+
+    RingBuffer<int32_t, 4> r;
+    for (int32_t v = 1; v <= 6; v++)
+    {
+        r.addValue(v);
+    }
+    TEST_ASSERT_TRUE(r.isFull());
+    TEST_ASSERT_EQUAL_INT32(3, r.getValue(0)); // oldest first after the wrap
+    TEST_ASSERT_EQUAL_INT32(6, r.getValue(3));
+    TEST_ASSERT_EQUAL_INT32(3 + 4 + 5 + 6, r.getSum());
+}
+
+void test_chain_runs_stages_in_order()
+{
+    FilterChain<Median<5>, Ema<2>, Window<20>> f;
+    for (int i = 0; i < 100; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32(filterIn(160), f.apply(filterIn(160)));
+    }
+    // The spike is gone before the EMA and window see it
+    TEST_ASSERT_EQUAL_INT32(filterIn(160), f.apply(filterIn(30000)));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 160, filterToFloat(f.apply(filterIn(160))));
+
+    f.reset();
+    TEST_ASSERT_EQUAL_INT32(filterIn(80), f.apply(filterIn(80)));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_median_rejects_spikes);
+    RUN_TEST(test_ema_step_response);
+    RUN_TEST(test_window_wraps);
+    RUN_TEST(test_chain_runs_stages_in_order);
+    return UNITY_END();
+}
@@ -0,0 +1,84 @@
+/*
+ *  Host test: the fixed-point signal path (FIXED_MATH) must match the float path
+ *  within 0.01 % O2 over the sensor's working range.
+ *
+ *  pio test -e native -f test_fixed_point
+ */
+
+#include <unity.h>
+#include <stdlib.h>
+#include "gas_math.h"
+#include "ring_buffer.h"
+
+#define WINDOW 20
+
+void setUp() {}
+void tearDown() {}
+
+// Window average, calibration and O2 over calibration points from a weak to a hot cell
+void test_o2_matches_float()
+{
+    srand(1);
+    for (int air = 40; air <= 1200; air += 7) // counts in air, about 2.5 - 75 mV
+    {
+        RingBuffer<int16_t, WINDOW> cal;
+        float calSum = 0;
+        for (int i = 0; i < WINDOW; i++)
+        {
+            int16_t v = air + (rand() % 5) - 2;
+            cal.addValue(v);
+            calSum += v;
+        }
+        float calFactor = calFactorFor(calSum / WINDOW);
+        q24_t calFactorQ = calFactorQ24(cal.getSum(), cal.getCount());
+
+        for (int pct = 5; pct <= 100; pct++)
+        {
+            RingBuffer<int16_t, WINDOW> ra;
+            float sum = 0;
+            int target = (air * pct) / 21;
+            for (int i = 0; i < WINDOW * 2; i++) // wraps the window once
+            {
+                int16_t v = target + (rand() % 9) - 4;
+                ra.addValue(v);
+                if (i >= WINDOW)
+                {
+                    sum += v;
+                }
+            }
+            float o2 = o2FromCounts(sum / WINDOW, calFactor);
+            q16_t o2Q = o2FromCountsQ16(ra.averageQ16(), calFactorQ);
+            TEST_ASSERT_FLOAT_WITHIN(0.01, o2, q16ToFloat(o2Q));
+        }
+    }
+}
+
+// MODs may only differ where the float result sits on a whole foot / metre
+void test_mod_matches_float()
+{
+    for (int tenths = 100; tenths <= 999; tenths++)
+    {
+        float o2 = tenths / 10.0;
+        q16_t o2Q = q16(o2);
+        TEST_ASSERT_INT_WITHIN(1, modDepth(o2, 1.4, 33), modDepthQ16(o2Q, q16(1.4), 33));
+        TEST_ASSERT_INT_WITHIN(1, modDepth(o2, 1.6, 33), modDepthQ16(o2Q, q16(1.6), 33));
+        TEST_ASSERT_INT_WITHIN(1, modDepth(o2, 1.4, 10), modDepthQ16(o2Q, q16(1.4), 10));
+        TEST_ASSERT_INT_WITHIN(1, modDepth(o2, 1.6, 10), modDepthQ16(o2Q, q16(1.6), 10));
+    }
+}
+
+void test_display_rounding()
+{
+    TEST_ASSERT_EQUAL_INT32(321, q16ToTenths(q16(32.14)));
+    TEST_ASSERT_EQUAL_INT32(322, q16ToTenths(q16(32.16)));
+    TEST_ASSERT_EQUAL_INT32(999, q16ToTenths(q16(O2_MAX)));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_o2_matches_float);
+    RUN_TEST(test_mod_matches_float);
+    RUN_TEST(test_display_rounding);
+    return UNITY_END();
+}
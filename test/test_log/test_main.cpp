@@ -0,0 +1,112 @@
+/*
+ *  Host test: log lines above their subsystem threshold are neither formatted
+ *  nor have their arguments evaluated, the others reach the sink as one
+ *  "<ms> <level> <tag> <message>" line, cut to LOG_LINE_MAX.
+ *
+ *  pio test -e native -f test_log
+ */
+
+#define LOG_LEVEL LOG_INFO
+#define LOG_LEVEL_CAL LOG_TRACE // one subsystem traced
+#define LOG_LEVEL_UI LOG_ERROR  // one quieter
+#define LOG_LINE_MAX 48
+
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "log.h"
+
+std::vector<std::string> lines;
+LogLine last; // text and msg are only valid inside the sink
+int evaluated;
+
+void sink(const LogLine &line)
+{
+    TEST_ASSERT_EQUAL(strlen(line.text), line.len);
+    lines.push_back(line.text);
+    last = line;
+}
+
+uint32_t clockMs()
+{
+    return 1234;
+}
+
+int touch()
+{
+    return ++evaluated;
+}
+
+void setUp()
+{
+    lines.clear();
+    evaluated = 0;
+    logConfig().sink = sink;
+    logConfig().clockMs = clockMs;
+}
+
+void tearDown() {}
+
+void test_line_layout()
+{
+    logI(CAL, "mean=%s ms=%lu", LogFloat(160.256f).s, 4100UL);
+    TEST_ASSERT_EQUAL(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("1234 I CAL mean=160.26 ms=4100\n", lines[0].c_str());
+    TEST_ASSERT_EQUAL(LOG_INFO, last.level);
+    TEST_ASSERT_EQUAL(1234, last.ms);
+}
+
+void test_thresholds()
+{
+    logT(SYS, "%d", touch()); // above LOG_LEVEL
+    logW(UI, "%d", touch());  // above LOG_LEVEL_UI
+    TEST_ASSERT_EQUAL(0, lines.size());
+    TEST_ASSERT_EQUAL(0, evaluated);
+
+    logT(CAL, "%d", touch());
+    logE(UI, "%d", touch());
+    logW(SYS, "%d", touch());
+    TEST_ASSERT_EQUAL(3, lines.size());
+    TEST_ASSERT_EQUAL(3, evaluated);
+    TEST_ASSERT_EQUAL_STRING("1234 T CAL 1\n", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("1234 E UI 2\n", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("1234 W SYS 3\n", lines[2].c_str());
+}
+
+void test_long_line_cut()
+{
+    logW(ADC, "%s", "recovering, bus errors, recovering, bus errors, recovering");
+    TEST_ASSERT_EQUAL(LOG_LINE_MAX - 1, last.len);
+    TEST_ASSERT_EQUAL(LOG_LINE_MAX - 1, lines[0].size());
+    TEST_ASSERT_EQUAL('\n', lines[0].back());
+    TEST_ASSERT_EQUAL(0, lines[0].compare(0, 21, "1234 W ADC recovering"));
+}
+
+void test_no_sink()
+{
+    logConfig().sink = nullptr;
+    logE(ADC, "%d", touch());
+    TEST_ASSERT_EQUAL(0, lines.size());
+}
+
+void test_float_text()
+{
+    TEST_ASSERT_EQUAL_STRING("0.00", LogFloat(0).s);
+    TEST_ASSERT_EQUAL_STRING("-1.50", LogFloat(-1.5f).s);
+    TEST_ASSERT_EQUAL_STRING("0.00", LogFloat(-0.001f).s);
+    TEST_ASSERT_EQUAL_STRING("0.021", LogFloat(0.0214f, 3).s);
+    TEST_ASSERT_EQUAL_STRING("21", LogFloat(20.9f, 0).s);
+    TEST_ASSERT_EQUAL_STRING("inf", LogFloat(1e12f).s);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_line_layout);
+    RUN_TEST(test_thresholds);
+    RUN_TEST(test_long_line_cut);
+    RUN_TEST(test_no_sink);
+    RUN_TEST(test_float_text);
+    return UNITY_END();
+}
@@ -0,0 +1,80 @@
+/*
+ *  Host test: colours look up their palette index at compile time, and packed
+ *  4 bpp rows expand left pixel first to byte swapped RGB565, the same in
+ *  chunks of rows as in one go.
+ *
+ *  pio test -e native -f test_palette
+ */
+
+#include <unity.h>
+#include <string.h>
+#include "palette.h"
+
+constexpr uint16_t pal[PALETTE_SIZE] = {
+    0x0000, 0x00A3, 0x03EF, 0x03E0, 0xFFFF, 0xFDA0, 0x07FF, 0xFFE0,
+    0xF800, 0x07E0, 0xC618, 0xB7E0, 0x001F, 0x055D, 0x0311, 0xF811};
+
+static_assert(PALETTE_INDEX(pal, 0x0000) == 0, "first entry");
+static_assert(PALETTE_INDEX(pal, 0xF811) == 15, "last entry");
+
+void setUp() {}
+void tearDown() {}
+
+void test_index()
+{
+    TEST_ASSERT_EQUAL(4, PALETTE_INDEX(pal, 0xFFFF));
+    TEST_ASSERT_EQUAL(8, paletteIndex(pal, 0xF800));
+    for (uint8_t i = 0; i < PALETTE_SIZE; i++)
+    {
+        TEST_ASSERT_EQUAL(i, paletteIndex(pal, pal[i]));
+    }
+}
+
+void test_expand_left_pixel_first()
+{
+    uint16_t lut[PALETTE_SIZE];
+    paletteSwapped(pal, lut);
+    TEST_ASSERT_EQUAL_HEX16(0xA300, lut[1]);
+
+    const uint8_t row[2] = {0x48, 0xF0}; // white, red, needle, black
+    uint16_t out[4];
+    paletteExpand(row, out, 4, lut);
+    TEST_ASSERT_EQUAL_HEX16(0xFFFF, out[0]);
+    TEST_ASSERT_EQUAL_HEX16(0x00F8, out[1]);
+    TEST_ASSERT_EQUAL_HEX16(0x11F8, out[2]);
+    TEST_ASSERT_EQUAL_HEX16(0x0000, out[3]);
+}
+
+// A 240 x 24 strip sent 4 rows at a time comes out as the whole strip would
+void test_expand_in_chunks()
+{
+    const int w = 240, h = 24, rows = 4;
+    static uint8_t strip[w * h / 2];
+    for (int i = 0; i < w * h / 2; i++)
+    {
+        strip[i] = (uint8_t)(i * 37 + (i >> 3));
+    }
+    uint16_t lut[PALETTE_SIZE];
+    paletteSwapped(pal, lut);
+
+    static uint16_t whole[w * h];
+    static uint16_t chunked[w * h];
+    paletteExpand(strip, whole, w * h, lut);
+    uint16_t line[w * rows];
+    for (int row = 0; row < h; row += rows)
+    {
+        paletteExpand(strip + row * w / 2, line, rows * w, lut);
+        memcpy(chunked + row * w, line, sizeof(line));
+    }
+    TEST_ASSERT_EQUAL_MEMORY(whole, chunked, sizeof(whole));
+    TEST_ASSERT_EQUAL_HEX16(lut[strip[w / 2] >> 4], whole[w]); // second row starts mid buffer
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_index);
+    RUN_TEST(test_expand_left_pixel_first);
+    RUN_TEST(test_expand_in_chunks);
+    return UNITY_END();
+}
@@ -0,0 +1,81 @@
+/*
+ *  Host test: the per-stage profile.  Durations land in their power-of-two
+ *  bucket, count, min, mean and max follow the runs, reset clears them, and
+ *  the dump writes one line per stage with the non-empty buckets.
+ *
+ *  pio test -e native -f test_prof
+ */
+
+#include <unity.h>
+#include <string.h>
+#include "prof.h"
+
+static char dump[512];
+
+static void out(const char *s)
+{
+    strncat(dump, s, sizeof(dump) - strlen(dump) - 1);
+}
+
+void setUp() { dump[0] = 0; }
+void tearDown() {}
+
+void test_buckets()
+{
+    TEST_ASSERT_EQUAL(0, profBucket(0));
+    TEST_ASSERT_EQUAL(0, profBucket(1));
+    TEST_ASSERT_EQUAL(1, profBucket(2));
+    TEST_ASSERT_EQUAL(1, profBucket(3));
+    TEST_ASSERT_EQUAL(2, profBucket(4));
+    TEST_ASSERT_EQUAL(9, profBucket(1023));
+    TEST_ASSERT_EQUAL(10, profBucket(1024));
+    TEST_ASSERT_EQUAL(PROF_BUCKETS - 1, profBucket(1UL << (PROF_BUCKETS - 1)));
+    TEST_ASSERT_EQUAL(PROF_BUCKETS - 1, profBucket(UINT32_MAX)); // long runs pile up in the last
+}
+
+void test_stats_and_reset()
+{
+    ProfStage s("filter");
+    TEST_ASSERT_EQUAL_UINT32(0, s.n);
+    profAdd(s, 100);
+    profAdd(s, 120);
+    profAdd(s, 500);
+    TEST_ASSERT_EQUAL_UINT32(3, s.n);
+    TEST_ASSERT_EQUAL_UINT32(100, s.min);
+    TEST_ASSERT_EQUAL_UINT32(500, s.max);
+    TEST_ASSERT_EQUAL_UINT32(720, (uint32_t)s.sum);
+    TEST_ASSERT_EQUAL_UINT32(2, s.hist[6]); // 64 .. 127
+    TEST_ASSERT_EQUAL_UINT32(1, s.hist[8]); // 256 .. 511
+
+    profReset(s);
+    TEST_ASSERT_EQUAL_UINT32(0, s.n);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, s.min);
+    TEST_ASSERT_EQUAL_UINT32(0, s.hist[6]);
+    profAdd(s, 7);
+    TEST_ASSERT_EQUAL_UINT32(7, s.min);
+    TEST_ASSERT_EQUAL_UINT32(7, s.max);
+}
+
+void test_dump()
+{
+    ProfStage a("sample");
+    ProfStage b("render");
+    profAdd(a, 100);
+    profAdd(a, 120);
+    profAdd(a, 500);
+    ProfStage *stages[] = {&a, &b};
+    profDump(stages, 2, "us", out);
+    TEST_ASSERT_EQUAL_STRING("prof stage n min mean max (us) | bucket:count\n"
+                             "prof sample   3 100 240 500 | 64:2 256:1\n"
+                             "prof render   0 0 0 0 |\n",
+                             dump);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_buckets);
+    RUN_TEST(test_stats_and_reset);
+    RUN_TEST(test_dump);
+    return UNITY_END();
+}
@@ -0,0 +1,131 @@
+/*
+ *  Host test: the multi-rate scheduler on a simulated clock.  Each job runs
+ *  once a period, the first due job in the table goes first, a job that runs
+ *  past its deadline counts an overrun, and a stall skips the periods it missed
+ *  instead of running them back to back.
+ *
+ *  pio test -e native -f test_scheduler
+ */
+
+#include <unity.h>
+#include "scheduler.h"
+
+static uint32_t nowUs;
+static uint32_t clockUs() { return nowUs; }
+
+// Each job takes its cost off the clock and logs the order the first ones ran in
+static uint32_t fastCostUs;
+static uint32_t slowCostUs;
+static char order[4]; // the first three runs
+static uint8_t orderLen;
+
+static void logRun(char c)
+{
+    if (orderLen < sizeof(order) - 1)
+    {
+        order[orderLen++] = c;
+        order[orderLen] = 0;
+    }
+}
+
+static void fastJob()
+{
+    nowUs += fastCostUs;
+    logRun('f');
+}
+
+static void slowJob()
+{
+    nowUs += slowCostUs;
+    logRun('s');
+}
+
+Scheduler *sched;
+
+void setUp()
+{
+    nowUs = 0;
+    fastCostUs = 200;
+    slowCostUs = 2000;
+    orderLen = 0;
+    order[0] = 0;
+    sched = new Scheduler;
+    sched->clockUs = clockUs;
+    schedAdd(*sched, "fast", fastJob, 10, 10, 0);
+    schedAdd(*sched, "slow", slowJob, 100, 50, 0);
+}
+
+void tearDown() { delete sched; }
+
+// Run the loop as main.cpp does, sleeping whatever schedRun() hands back
+static void runUntil(uint32_t endMs)
+{
+    while (nowUs / 1000 < endMs)
+    {
+        uint32_t wait = schedRun(*sched, nowUs / 1000);
+        nowUs += wait * 1000;
+    }
+}
+
+void test_periods_and_priority()
+{
+    runUntil(1000);
+    TEST_ASSERT_EQUAL_STRING("fsf", order); // both due at 0, table order
+    TEST_ASSERT_EQUAL_UINT32(100, sched->jobs[0].runs);
+    TEST_ASSERT_EQUAL_UINT32(10, sched->jobs[1].runs);
+    TEST_ASSERT_EQUAL_UINT32(0, sched->jobs[0].overruns);
+    TEST_ASSERT_EQUAL_UINT32(0, sched->jobs[1].overruns);
+    TEST_ASSERT_EQUAL_UINT32(200, sched->jobs[0].maxUs);
+    TEST_ASSERT_EQUAL_UINT32(2000, sched->jobs[1].maxUs);
+}
+
+void test_wait_until_next_release()
+{
+    uint32_t wait = schedRun(*sched, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, wait); // ran fast, slow still due
+    wait = schedRun(*sched, 0);
+    TEST_ASSERT_EQUAL_UINT32(8, wait); // ran slow, done at 2 ms, fast due at 10
+
+    Scheduler empty;
+    wait = schedRun(empty, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, wait);
+    for (uint8_t i = sched->count; i < SCHED_MAX_JOBS; i++)
+    {
+        TEST_ASSERT_TRUE(schedAdd(*sched, "pad", fastJob, 1000, 1000, 0));
+    }
+    TEST_ASSERT_FALSE(schedAdd(*sched, "more", fastJob, 1000, 1000, 0)); // table full
+}
+
+void test_overrun_past_deadline()
+{
+    slowCostUs = 60000; // deadline 50 ms
+    runUntil(1000);
+    TEST_ASSERT_EQUAL_UINT32(10, sched->jobs[1].runs);
+    TEST_ASSERT_EQUAL_UINT32(10, sched->jobs[1].overruns);
+    TEST_ASSERT_EQUAL_UINT32(60000, sched->jobs[1].maxUs);
+    // The fast job waits out every 60 ms block: late, and its missed periods skipped
+    TEST_ASSERT_GREATER_THAN(0, sched->jobs[0].overruns);
+    TEST_ASSERT_LESS_THAN(100, sched->jobs[0].runs);
+}
+
+void test_stall_skips_missed_periods()
+{
+    runUntil(50);
+    uint32_t runs = sched->jobs[0].runs;
+    nowUs += 1000000; // a second with the loop stuck elsewhere
+    schedRun(*sched, nowUs / 1000);
+    TEST_ASSERT_EQUAL_UINT32(runs + 1, sched->jobs[0].runs); // once, not 100 times
+    TEST_ASSERT_EQUAL_UINT32(1, sched->jobs[0].overruns);
+    TEST_ASSERT_GREATER_THAN(nowUs / 1000, sched->jobs[0].releaseMs);
+    TEST_ASSERT_LESS_OR_EQUAL(nowUs / 1000 + 10, sched->jobs[0].releaseMs);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_periods_and_priority);
+    RUN_TEST(test_wait_until_next_release);
+    RUN_TEST(test_overrun_past_deadline);
+    RUN_TEST(test_stall_skips_missed_periods);
+    return UNITY_END();
+}
@@ -0,0 +1,124 @@
+/*
+ *  Host test: the settle predictor finds the final O2 of a first-order step,
+ *  and on the simulated cell (air to EAN32, tau 3 s): the first prediction comes
+ *  within 1.7 s of the step, from 2 s on it stays within 0.2 % O2 (the cell
+ *  itself still reads under 28 %), and the band holds the truth in at least
+ *  90 % of the frames.
+ *
+ *  pio test -e native -f test_settle_predictor
+ */
+
+#include <unity.h>
+#include <stdlib.h>
+#include <math.h>
+#include "hal/sim_sensor.h"
+#include "filter_chain.h"
+#include "cal_engine.h"
+#include "pipeline.h"
+
+void setUp() {}
+void tearDown() {}
+
+// A clean exponential: the fit lands on the asymptote and the time constant
+void test_exact_first_order()
+{
+    SettlePredictor p;
+    for (uint32_t ms = 0; ms <= 2000; ms += PRED_DT_MS)
+    {
+        predAdd(p, ms, 32 - (32 - 20.9) * expf(-(float)ms / 3000.0f));
+    }
+    TEST_ASSERT_EQUAL(PRED_PREDICTING, p.state);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 32.0, p.predicted);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 3.0, p.tau);
+    TEST_ASSERT_LESS_THAN(0.05, p.band);
+
+    for (uint32_t ms = 2100; ms <= 30000; ms += PRED_DT_MS)
+    {
+        predAdd(p, ms, 32 - (32 - 20.9) * expf(-(float)ms / 3000.0f));
+    }
+    TEST_ASSERT_EQUAL(PRED_SETTLED, p.state);
+}
+
+// Flat input never predicts
+void test_flat_is_settled()
+{
+    SettlePredictor p;
+    for (uint32_t ms = 0; ms <= 5000; ms += PRED_DT_MS)
+    {
+        TEST_ASSERT_EQUAL(PRED_SETTLED, predAdd(p, ms, 20.9));
+    }
+}
+
+// The full pipeline on the simulated cell, one frame every 33 ms as on target
+void test_sim_step_prediction()
+{
+    SimClock clk;
+    SensorModel m;
+    m.t90S = 3 * log(10.0); // tau 3 s
+    SimO2Sensor cell(clk, 250, m);
+    std::vector<GasStep> script;
+    script.push_back(GasStep{0, 20.9, 25});
+    script.push_back(GasStep{15, 32, 25});
+    cell.setScript(script);
+
+    Pipeline pipeline;
+    pipelineSetMultiplier(pipeline, cell.mvPerCount());
+    CalEngine cal;
+    calBegin(cal, clk.millis());
+    while (calAdd(cal, clk.millis(), abs(cell.next())) == CAL_RUNNING)
+    {
+    }
+    TEST_ASSERT_TRUE(cal.state == CAL_DONE);
+    pipelineCalibrate(pipeline, cal.sum, cal.count);
+    pipeline.fastRead = true;
+
+    FilterChain<Median<5>, Ema<2>, Window<20>> filter;
+    Reading rd;
+    uint32_t nextFrame = clk.millis();
+    uint32_t firstMs = 0;
+    int predicted = 0, inBand = 0;
+    bool checked = false;
+    while (clk.millis() < 40000)
+    {
+        int32_t filtered = filter.apply(filterIn(abs(cell.next())));
+        if ((int32_t)(clk.millis() - nextFrame) < 0)
+        {
+            continue;
+        }
+        nextFrame += 33;
+        pipelineProcess(pipeline, filtered, 3.9, clk.millis(), rd);
+        if (rd.predicting)
+        {
+            firstMs = firstMs ? firstMs : clk.millis();
+            TEST_ASSERT_LESS_THAN(PRED_MAX_BAND, rd.band);
+            predicted++;
+            inBand += (fabsf(rd.o2 - 32.0f) <= rd.band);
+            if (clk.millis() >= 17000)
+            {
+                TEST_ASSERT_FLOAT_WITHIN(0.2, 32.0, rd.o2);
+            }
+        }
+        if (!checked && clk.millis() >= 17000)
+        {
+            checked = true;
+            TEST_ASSERT_TRUE(rd.predicting);
+            TEST_ASSERT_LESS_THAN(28.0, rd.o2Measured); // the cell is still well short
+            TEST_ASSERT_FLOAT_WITHIN(0.2, 32.0, rd.o2);
+        }
+    }
+    TEST_ASSERT_TRUE(checked);
+    TEST_ASSERT_GREATER_THAN(predicted * 0.9, (float)inBand); // the 95 % band mostly holds the truth
+    TEST_ASSERT_GREATER_THAN(15000, (float)firstMs);
+    TEST_ASSERT_LESS_THAN(16700, (float)firstMs); // a prediction within 1.7 s of the step
+    TEST_ASSERT_FALSE(rd.predicting); // measured again once settled
+    TEST_ASSERT_FLOAT_WITHIN(0.2, 32.0, rd.o2);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_exact_first_order);
+    RUN_TEST(test_flat_is_settled);
+    RUN_TEST(test_sim_step_prediction);
+    return UNITY_END();
+}
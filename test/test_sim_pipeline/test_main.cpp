@@ -0,0 +1,144 @@
+/*
+ *  Host test: the reading pipeline and text UI on the simulated HAL.  Calibrates
+ *  in air, switches to a nitrox mix and checks what ends up on the screen, and
+ *  checks the simulated cell's response time and ADC resolution.
+ *
+ *  pio test -e native -f test_sim_pipeline
+ */
+
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hal/sim_sensor.h"
+#include "filter_chain.h"
+#include "cal_engine.h"
+#include "pipeline.h"
+#include "text_ui.h"
+
+#define AIR_MV 10.0
+
+SimClock *clk;
+SimAdc *adc;
+MemorySurface *screen;
+Pipeline *pipeline;
+TextUi *ui;
+
+void setUp()
+{
+    clk = new SimClock;
+    adc = new SimAdc(*clk, 250, 0.0625);
+    screen = new MemorySurface(240, 240);
+    pipeline = new Pipeline;
+    ui = new TextUi;
+    adc->setMv(AIR_MV);
+    adc->setNoise(1.0);
+    pipelineSetMultiplier(*pipeline, adc->mvPerCount());
+    ui->d = screen;
+    ui->cfg.version = "test";
+}
+
+void tearDown()
+{
+    delete ui;
+    delete pipeline;
+    delete screen;
+    delete adc;
+    delete clk;
+}
+
+static void calibrate()
+{
+    CalEngine cal;
+    calBegin(cal, clk->millis());
+    while (calAdd(cal, clk->millis(), abs(adc->next())) == CAL_RUNNING)
+    {
+    }
+    TEST_ASSERT_TRUE(cal.state == CAL_DONE);
+    pipelineCalibrate(*pipeline, cal.sum, cal.count);
+}
+
+// Run for ms, one frame every 33 ms as on target
+static void run(uint32_t ms, Reading &rd)
+{
+    FilterChain<Median<5>, Ema<2>, Window<20>> filter;
+    uint32_t end = clk->millis() + ms;
+    uint32_t nextFrame = clk->millis();
+    while ((int32_t)(clk->millis() - end) < 0)
+    {
+        int32_t filtered = filter.apply(filterIn(abs(adc->next())));
+        if ((int32_t)(clk->millis() - nextFrame) >= 0)
+        {
+            nextFrame += 33;
+            pipelineProcess(*pipeline, filtered, 3.9, clk->millis(), rd);
+            uiRender(*ui, rd, clk->millis());
+        }
+    }
+}
+
+void test_air_reads_20_9()
+{
+    Reading rd;
+    calibrate();
+    screen->fillScreen(TFT_BLACK);
+    uiBaseLayout(*ui);
+    run(5000, rd);
+    TEST_ASSERT_FLOAT_WITHIN(0.2, 20.9, rd.o2);
+    TEST_ASSERT_FLOAT_WITHIN(0.2, AIR_MV, rd.mV);
+    TEST_ASSERT_EQUAL(0, adc->missed);
+}
+
+void test_nitrox_on_screen()
+{
+    Reading rd;
+    calibrate();
+    screen->fillScreen(TFT_BLACK);
+    uiBaseLayout(*ui);
+    run(2000, rd);
+    adc->setMv(AIR_MV * 32 / O2_AIR);
+    run(8000, rd);
+    TEST_ASSERT_FLOAT_WITHIN(0.2, 32.0, rd.o2);
+    TEST_ASSERT_TRUE(rd.stable);
+
+    const MemorySurface::Text *o2 = screen->textNear(52);
+    TEST_ASSERT_TRUE(o2 != nullptr);
+    TEST_ASSERT_EQUAL_STRING("32.0", o2->s.c_str());
+    const MemorySurface::Text *status = screen->textNear(208);
+    TEST_ASSERT_TRUE(status != nullptr);
+    TEST_ASSERT_EQUAL_STRING("STABLE", status->s.c_str());
+}
+
+// The cell covers 90 % of a step in t90, and the ADC steps at the PGA resolution
+void test_sensor_t90_and_pga()
+{
+    SensorModel m;
+    m.whiteMv = 0;
+    m.pinkMv = 0;
+    m.t90S = 5;
+    m.pga = 4; // GAIN_EIGHT, 0.015625 mV per count
+    SimO2Sensor cell(*clk, 250, m);
+    std::vector<GasStep> script;
+    script.push_back(GasStep{0, 20.9, 25});
+    script.push_back(GasStep{1, 50, 25});
+    cell.setScript(script);
+
+    while (clk->nowUs() < 6000000)
+    {
+        cell.next();
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.3, 20.9 + 0.9 * (50 - 20.9), cell.cellO2);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.015625, cell.mvPerCount());
+    while (clk->nowUs() < 60000000)
+    {
+        cell.next();
+    }
+    TEST_ASSERT_INT_WITHIN(1, lround(50 * m.mvPerPct / 0.015625), cell.next());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_air_reads_20_9);
+    RUN_TEST(test_nitrox_on_screen);
+    RUN_TEST(test_sensor_t90_and_pga);
+    return UNITY_END();
+}
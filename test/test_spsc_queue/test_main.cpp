@@ -0,0 +1,82 @@
+/*
+ *  Host test: the single-producer / single-consumer ring.  It holds N - 1
+ *  entries, counts the pushes it drops when full, keeps FIFO order across the
+ *  wrap of its indices, and latest() drains it down to the newest entry.
+ *
+ *  pio test -e native -f test_spsc_queue
+ */
+
+#include <unity.h>
+#include "spsc_queue.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_full_drops_and_counts()
+{
+    SpscQueue<uint16_t, 8> q;
+    TEST_ASSERT_TRUE(q.empty());
+    for (uint16_t i = 0; i < 7; i++)
+    {
+        TEST_ASSERT_TRUE(q.push(i));
+    }
+    TEST_ASSERT_FALSE(q.push(100)); // one slot stays free to tell full from empty
+    TEST_ASSERT_FALSE(q.push(101));
+    TEST_ASSERT_EQUAL_UINT32(2, q.dropped());
+
+    uint16_t v;
+    for (uint16_t i = 0; i < 7; i++)
+    {
+        TEST_ASSERT_TRUE(q.pop(v));
+        TEST_ASSERT_EQUAL(i, v); // the dropped pushes left nothing behind
+    }
+    TEST_ASSERT_FALSE(q.pop(v));
+    TEST_ASSERT_TRUE(q.empty());
+    TEST_ASSERT_EQUAL_UINT32(2, q.dropped());
+}
+
+void test_order_across_wrap()
+{
+    SpscQueue<uint32_t, 4> q;
+    uint32_t in = 0;
+    uint32_t out = 0;
+    uint32_t v;
+    // Uneven push and pop runs walk the indices round the ring many times
+    for (int round = 0; round < 1000; round++)
+    {
+        for (int i = 0; i < 1 + round % 3; i++)
+        {
+            TEST_ASSERT_TRUE(q.push(in++));
+        }
+        while (q.pop(v))
+        {
+            TEST_ASSERT_EQUAL_UINT32(out++, v);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(in, out);
+    TEST_ASSERT_EQUAL_UINT32(0, q.dropped());
+}
+
+void test_latest_keeps_newest()
+{
+    SpscQueue<int16_t, 16> q;
+    int16_t v = -1;
+    TEST_ASSERT_FALSE(q.latest(v));
+    TEST_ASSERT_EQUAL_INT16(-1, v);
+    for (int16_t i = 1; i <= 5; i++)
+    {
+        q.push(i * 10);
+    }
+    TEST_ASSERT_TRUE(q.latest(v));
+    TEST_ASSERT_EQUAL_INT16(50, v);
+    TEST_ASSERT_TRUE(q.empty());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_full_drops_and_counts);
+    RUN_TEST(test_order_across_wrap);
+    RUN_TEST(test_latest_keeps_newest);
+    return UNITY_END();
+}
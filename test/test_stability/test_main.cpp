@@ -0,0 +1,85 @@
+/*
+ *  Host test: the stability detector goes STABLE once a window is flat, not on
+ *  a drift or a noisy reading, re-arms on a step of gas and records the time
+ *  each analysis took to reach STABLE.
+ *
+ *  pio test -e native -f test_stability
+ */
+
+#include <unity.h>
+#include "stability.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Feed value every 33 ms (a frame) from fromMs up to toMs
+static void feed(StabilityDetector &d, uint32_t fromMs, uint32_t toMs, float value, float slopePerS = 0)
+{
+    for (uint32_t ms = fromMs; ms < toMs; ms += 33)
+    {
+        stabAdd(d, ms, value + slopePerS * (ms - fromMs) / 1000.0f);
+    }
+}
+
+void test_flat_goes_stable()
+{
+    StabilityDetector d;
+    feed(d, 0, STABLE_WINDOW_MS - 100, 20.9);
+    TEST_ASSERT_EQUAL(STAB_UNSTABLE, d.state); // window not full yet
+    feed(d, STABLE_WINDOW_MS - 100, 3000, 20.9);
+    TEST_ASSERT_EQUAL(STAB_STABLE, d.state);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 20.9, d.stableValue);
+    TEST_ASSERT_EQUAL(1, d.analyses);
+    TEST_ASSERT_INT_WITHIN(STABLE_DT_MS, STABLE_WINDOW_MS, d.lastTimeMs);
+}
+
+void test_drift_and_noise_stay_unstable()
+{
+    StabilityDetector d;
+    feed(d, 0, 10000, 20.9, 0.1); // 0.1 % O2 a second
+    TEST_ASSERT_EQUAL(STAB_UNSTABLE, d.state);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0.1, d.slope);
+
+    StabilityDetector n;
+    for (uint32_t ms = 0; ms < 10000; ms += 33)
+    {
+        stabAdd(n, ms, 20.9 + (((ms / 100) & 1) ? 0.15 : -0.15)); // flat but jumping
+    }
+    TEST_ASSERT_EQUAL(STAB_UNSTABLE, n.state);
+    TEST_ASSERT_GREATER_THAN(STABLE_SD_PCT, n.sd);
+    TEST_ASSERT_EQUAL(0, n.analyses);
+}
+
+// A new cylinder: the step re-arms the analysis, the time is taken from the step
+void test_step_rearms_and_times()
+{
+    StabilityDetector d;
+    feed(d, 0, 5000, 20.9);
+    TEST_ASSERT_EQUAL(STAB_STABLE, d.state);
+    uint32_t first = d.lastTimeMs;
+
+    TEST_ASSERT_FALSE(stabAdd(d, 5016, 21.0)); // inside STABLE_STEP_PCT, and within STABLE_DT_MS
+    TEST_ASSERT_FALSE(stabAdd(d, 5100, 21.1)); // a small move is not a new analysis
+    TEST_ASSERT_EQUAL(STAB_STABLE, d.state);
+
+    TEST_ASSERT_TRUE(stabAdd(d, 5200, 32.0));
+    TEST_ASSERT_EQUAL(STAB_UNSTABLE, d.state);
+    TEST_ASSERT_EQUAL(5200, d.startMs);
+
+    feed(d, 5233, 12000, 32.0);
+    TEST_ASSERT_EQUAL(STAB_STABLE, d.state);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 32.0, d.stableValue);
+    TEST_ASSERT_EQUAL(2, d.analyses);
+    TEST_ASSERT_INT_WITHIN(STABLE_DT_MS, STABLE_WINDOW_MS, d.lastTimeMs); // the step has left the window
+    TEST_ASSERT_EQUAL(first > d.lastTimeMs ? first : d.lastTimeMs, d.maxTimeMs);
+    TEST_ASSERT_EQUAL((first + d.lastTimeMs) / 2, stabMeanTime(d));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_flat_goes_stable);
+    RUN_TEST(test_drift_and_noise_stay_unstable);
+    RUN_TEST(test_step_rearms_and_times);
+    return UNITY_END();
+}
@@ -0,0 +1,113 @@
+/*
+ *  Host test: binary telemetry frames decode back to the record, with zero
+ *  bytes in the payload, debug text between frames and a damaged frame.
+ *
+ *  pio test -e native -f test_telemetry
+ */
+
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include "telemetry.h"
+
+void setUp() {}
+void tearDown() {}
+
+static TelemetryRecord sample(uint32_t i)
+{
+    TelemetryRecord r;
+    r.msgid = i;
+    r.ms = 256 * i; // zero bytes in the payload
+    r.raw = -32768 + i;
+    r.adc = 160.0625;
+    r.mV = 10.001;
+    r.batV = 3.912;
+    r.o2 = 32.05;
+    r.o2Measured = 31.9;
+    r.mod14 = 111;
+    r.mod16 = -1;
+    r.stable = i & 1;
+    return r;
+}
+
+static void feed(TelemetryDecoder &d, const uint8_t *p, size_t n, std::vector<TelemetryRecord> &out)
+{
+    TelemetryRecord r;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (telemetryFeed(d, p[i], r))
+        {
+            out.push_back(r);
+        }
+    }
+}
+
+void test_round_trip()
+{
+    TelemetryRecord in = sample(3);
+    uint8_t f[TLM_FRAME_MAX];
+    uint8_t n = telemetryFrame(in, f);
+    TEST_ASSERT_LESS_OR_EQUAL(TLM_FRAME_MAX, n);
+    TEST_ASSERT_EQUAL(0, f[0]);
+    TEST_ASSERT_EQUAL(0, f[n - 1]);
+    for (uint8_t i = 1; i < n - 1; i++)
+    {
+        TEST_ASSERT_TRUE(f[i] != 0);
+    }
+
+    TelemetryDecoder d;
+    std::vector<TelemetryRecord> out;
+    feed(d, f, n, out);
+    TEST_ASSERT_EQUAL(1, out.size());
+    TEST_ASSERT_EQUAL(in.msgid, out[0].msgid);
+    TEST_ASSERT_EQUAL(in.ms, out[0].ms);
+    TEST_ASSERT_EQUAL(in.raw, out[0].raw);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001, in.adc, out[0].adc);
+    TEST_ASSERT_FLOAT_WITHIN(0.0005, in.mV, out[0].mV);
+    TEST_ASSERT_FLOAT_WITHIN(0.0005, in.batV, out[0].batV);
+    TEST_ASSERT_FLOAT_WITHIN(0.005, in.o2, out[0].o2);
+    TEST_ASSERT_FLOAT_WITHIN(0.005, in.o2Measured, out[0].o2Measured);
+    TEST_ASSERT_EQUAL(in.mod14, out[0].mod14);
+    TEST_ASSERT_EQUAL(in.mod16, out[0].mod16);
+    TEST_ASSERT_EQUAL(in.stable, out[0].stable);
+}
+
+// Text printed between frames and a damaged frame cost only themselves
+void test_resync()
+{
+    std::vector<uint8_t> s;
+    const char text[] = "Stable after ms:2540\tMean ms:2540\r\n";
+    for (uint32_t i = 0; i < 20; i++)
+    {
+        uint8_t f[TLM_FRAME_MAX];
+        uint8_t n = telemetryFrame(sample(i), f);
+        if (i == 7)
+        {
+            f[10] ^= 0x04;
+        }
+        s.insert(s.end(), f, f + n);
+        if (i % 5 == 0)
+        {
+            s.insert(s.end(), text, text + sizeof(text) - 1);
+        }
+    }
+
+    TelemetryDecoder d;
+    std::vector<TelemetryRecord> out;
+    feed(d, s.data() + 5, s.size() - 5, out); // joined mid frame
+    TEST_ASSERT_EQUAL(18, out.size());        // not the first nor the damaged one
+    TEST_ASSERT_EQUAL(1, out[0].msgid);
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        TEST_ASSERT_TRUE(out[i].msgid != 7);
+    }
+    TEST_ASSERT_EQUAL(18, d.good);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_resync);
+    return UNITY_END();
+}
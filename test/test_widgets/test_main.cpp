@@ -0,0 +1,181 @@
+/*
+ *  Host test: retained widgets only draw when what they show changes, a shorter
+ *  text wipes the longer one, a steady text mode frame sends no pixels, and an
+ *  ADC fault replaces the reading.
+ *
+ *  pio test -e native -f test_widgets
+ */
+
+#include <unity.h>
+#include "hal/hal_sim.h"
+#include "widgets.h"
+#include "text_ui.h"
+
+MemorySurface *screen;
+
+void setUp()
+{
+    screen = new MemorySurface(240, 240);
+}
+
+void tearDown()
+{
+    delete screen;
+}
+
+void test_text_redraws_on_change()
+{
+    UiText t;
+    uiTextPlace(t, 120, 20, 2, 1, true);
+    TEST_ASSERT_TRUE(uiTextDraw(*screen, t, "10.0 mV", TFT_YELLOW, TFT_BLACK));
+    TEST_ASSERT_FALSE(uiTextDraw(*screen, t, "10.0 mV", TFT_YELLOW, TFT_BLACK));
+    TEST_ASSERT_TRUE(uiTextDraw(*screen, t, "10.0 mV", TFT_RED, TFT_BLACK));
+    TEST_ASSERT_FALSE(uiNumberDraw(*screen, t, 10.04, 1, " mV", TFT_RED, TFT_BLACK));
+    TEST_ASSERT_FALSE(uiNumberDraw(*screen, t, 9.96, 1, " mV", TFT_RED, TFT_BLACK)); // rounds like String(v, 1)
+    TEST_ASSERT_TRUE(uiNumberDraw(*screen, t, 9.94, 1, " mV", TFT_RED, TFT_BLACK));
+    TEST_ASSERT_EQUAL_STRING("9.9 mV", t.text);
+
+    uiTextInvalidate(t);
+    TEST_ASSERT_TRUE(uiTextDraw(*screen, t, "10.0 mV", TFT_RED, TFT_BLACK));
+}
+
+void test_format_clamps()
+{
+    char buf[12];
+    uiFormat(buf, sizeof(buf), 20.95, 1);
+    TEST_ASSERT_EQUAL_STRING("21.0", buf);
+    uiFormat(buf, sizeof(buf), -0.25, 2);
+    TEST_ASSERT_EQUAL_STRING("-0.25", buf);
+    uiFormat(buf, sizeof(buf), 1e9, 2);
+    TEST_ASSERT_EQUAL_STRING("99999.00", buf);
+    uiFormat(buf, sizeof(buf), -1e9, 0);
+    TEST_ASSERT_EQUAL_STRING("-99999", buf);
+}
+
+void test_shorter_text_wipes_longer()
+{
+    UiText t;
+    uiTextPlace(t, 120, 20, 2, 1, true);
+    uiTextDraw(*screen, t, "est +/-1.5", TFT_SILVER, TFT_BLACK);
+    int16_t wide = t.box.w;
+    TEST_ASSERT_EQUAL(TFT_BLACK, screen->pixel(120 - wide / 2 + 1, 21)); // text background
+    screen->fillRect(0, 0, 240, 240, TFT_BLUE); // mark the panel
+    uiTextDraw(*screen, t, "STABLE", TFT_GREEN, TFT_BLACK);
+    TEST_ASSERT_EQUAL(TFT_BLACK, screen->pixel(120 - wide / 2 + 1, 21)); // old box cleared
+    TEST_ASSERT_LESS_THAN(wide, t.box.w);
+    TEST_ASSERT_EQUAL(16, t.box.h);
+}
+
+void test_bar_sends_the_difference()
+{
+    UiBar b;
+    uiBarPlace(b, 10, 10, 23, 10, TFT_BLACK);
+    uiBarDraw(*screen, b, 23, TFT_GREEN);
+    TEST_ASSERT_EQUAL(230, screen->pixels);
+    TEST_ASSERT_FALSE(uiBarDraw(*screen, b, 23, TFT_GREEN));
+    TEST_ASSERT_EQUAL(230, screen->pixels);
+
+    uiBarDraw(*screen, b, 15, TFT_GREEN); // shrinks, same colour
+    TEST_ASSERT_EQUAL(230 + 80, screen->pixels);
+    TEST_ASSERT_EQUAL(TFT_BLACK, screen->pixel(10 + 20, 15));
+    TEST_ASSERT_EQUAL(TFT_GREEN, screen->pixel(10 + 14, 15));
+
+    uiBarDraw(*screen, b, 10, TFT_RED); // new colour, whole bar
+    TEST_ASSERT_EQUAL(230 + 80 + 230, screen->pixels);
+    TEST_ASSERT_EQUAL(TFT_RED, screen->pixel(10, 15));
+    TEST_ASSERT_EQUAL(TFT_BLACK, screen->pixel(10 + 12, 15));
+}
+
+// With the stats on, a frame whose reading shows the same is free
+void test_steady_frame_sends_nothing()
+{
+    TextUi ui;
+    ui.d = screen;
+    ui.cfg.version = "test";
+    Reading rd = {};
+    rd.mV = 10.0;
+    rd.batV = 3.9;
+    rd.o2 = 20.9;
+    rd.mod14fsw = 183;
+    rd.mod16fsw = 219;
+    rd.stable = true;
+
+    uiBaseLayout(ui);
+    uiRender(ui, rd, 0);
+    uint64_t first = screen->pixels;
+    TEST_ASSERT_GREATER_THAN(0, (float)first);
+
+    uiRender(ui, rd, 33);
+    rd.mV = 10.02; // same on screen
+    rd.batV = 3.91;
+    uiRender(ui, rd, 66);
+    TEST_ASSERT_EQUAL(first, screen->pixels);
+
+    rd.batV = 3.5; // battery bar and text only
+    uiRender(ui, rd, 99);
+    uint64_t sent = screen->pixels - first;
+    TEST_ASSERT_GREATER_THAN(0, (float)sent);
+    TEST_ASSERT_LESS_THAN(first / 10, (float)sent);
+    TEST_ASSERT_EQUAL(TFT_YELLOW, screen->pixel(240 * 0.8 + 1, 5 + 1));
+}
+
+// With the ADC off the bus the last O2 goes, the fault screen comes up
+void test_adc_fault_hides_reading()
+{
+    TextUi ui;
+    ui.d = screen;
+    ui.cfg.version = "test";
+    Reading rd = {};
+    rd.mV = 10.0;
+    rd.batV = 3.9;
+    rd.o2 = 20.9;
+    uiBaseLayout(ui);
+    uiRender(ui, rd, 0);
+    TEST_ASSERT_EQUAL(FAULT_NONE, ui.fault);
+
+    rd.adcFault = true;
+    uiRender(ui, rd, 33);
+    TEST_ASSERT_EQUAL(FAULT_ADC, ui.fault);
+    TEST_ASSERT_EQUAL(TFT_YELLOW, screen->pixel(0, 0));
+    for (size_t i = 0; i < screen->texts.size(); i++)
+    {
+        TEST_ASSERT_TRUE(screen->texts[i].s != "20.9");
+    }
+    uiRender(ui, rd, 66);
+    TEST_ASSERT_EQUAL(TFT_YELLOW, screen->pixel(0, 0)); // stays up
+
+    rd.adcFault = false;
+    uiRender(ui, rd, 33 + FAULT_MS);
+    TEST_ASSERT_EQUAL(FAULT_NONE, ui.fault);
+}
+
+// A board without a battery monitor reads 0 V, which is not a low battery
+void test_no_battery_monitor()
+{
+    TextUi ui;
+    ui.d = screen;
+    ui.cfg.version = "test";
+    ui.cfg.showBattery = false;
+    Reading rd = {};
+    rd.mV = 10.0;
+    rd.o2 = 20.9;
+    uiBaseLayout(ui);
+    uiRender(ui, rd, 0);
+    uiRender(ui, rd, 33);
+    TEST_ASSERT_EQUAL(FAULT_NONE, ui.fault);
+    TEST_ASSERT_EQUAL(TFT_BLACK, screen->pixel(240 * 0.8 + 1, 5 + 1)); // no gauge
+    TEST_ASSERT_FALSE(ui.nerdBat.valid);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_text_redraws_on_change);
+    RUN_TEST(test_format_clamps);
+    RUN_TEST(test_shorter_text_wipes_longer);
+    RUN_TEST(test_bar_sends_the_difference);
+    RUN_TEST(test_steady_frame_sends_nothing);
+    RUN_TEST(test_adc_fault_hides_reading);
+    RUN_TEST(test_no_battery_monitor);
+    return UNITY_END();
+}